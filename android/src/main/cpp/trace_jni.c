@@ -0,0 +1,31 @@
+// JNI bindings of the server thread tracing (see host/trace.h) for
+// com.lighttpd.Trace class; compiled into the Lighttpd library only
+// with WITH_RNSS_TRACE option.
+
+#include <errno.h>
+#include <jni.h>
+#include <limits.h>
+#include <string.h>
+
+#include "trace.h"
+
+JNIEXPORT void JNICALL Java_com_lighttpd_Trace_thread(JNIEnv *env, jclass cls) {
+  rnss_trace_thread();
+}
+
+JNIEXPORT jstring JNICALL Java_com_lighttpd_Trace_dumpTrace(
+  JNIEnv *env, jclass cls, jstring dir
+) {
+  char path[PATH_MAX];
+  const char *dir_chars = (*env)->GetStringUTFChars(env, dir, NULL);
+  if (!dir_chars) return NULL;
+  int res = rnss_trace_dump(dir_chars, path, sizeof(path));
+  int err = errno;
+  (*env)->ReleaseStringUTFChars(env, dir, dir_chars);
+  if (res) {
+    jclass error = (*env)->FindClass(env, "java/io/IOException");
+    if (error) (*env)->ThrowNew(env, error, strerror(err));
+    return NULL;
+  }
+  return (*env)->NewStringUTF(env, path);
+}
@@ -0,0 +1,259 @@
+package com.drpogodin.reactnativestaticserver
+
+import android.os.SystemClock
+import android.system.ErrnoException
+import android.system.Os
+import android.system.OsConstants
+import android.system.StructPollfd
+import android.util.Log
+import java.io.ByteArrayOutputStream
+import java.io.File
+import java.io.FileDescriptor
+import java.io.FileOutputStream
+import java.nio.ByteBuffer
+import java.nio.ByteOrder
+import kotlin.concurrent.thread
+
+/**
+ * Sampled binary access log.
+ *
+ * Lighttpd's mod_accesslog is configured (see src/accessLog.ts) to write
+ * a minimal numeric record per request into a FIFO (fifoPath); the reader
+ * thread parses these lines, samples them, and stores the sampled records
+ * into a fixed-size ring of compact binary records, overwriting the oldest
+ * ones once the ring is full. Thus, neither the server thread, nor the storage
+ * deal with the text log; the ring is exported in bulk on demand, in the binary
+ * format documented in host/rnss_accesslog.c (the decoder tool).
+ *
+ * Besides, it keeps request counters over all parsed lines, sampled or not
+ * (with zero capacity it keeps just the counters), reported by stats().
+ */
+class AccessLogBuffer(
+        val fifoPath: String,
+        private val capacity: Int,
+        private val sampleRate: Double
+) {
+    // NOTE: All fields below are guarded by the lock.
+    private val lock = Object()
+    private val ring = ByteBuffer.allocate(capacity * RECORD_SIZE)
+            .order(ByteOrder.LITTLE_ENDIAN)
+    private var written = 0L // Total count of records written into the ring.
+    private var seen = 0L // Total count of parsed log lines (requests).
+    private var bytesIn = 0L
+    private var bytesOut = 0L
+    private val latency = LongArray(LATENCY_BOUNDS_US.size + 1)
+    private val statuses = LongArray(STATUS_CLASSES)
+    private var startedAt = 0L
+
+    private var sampleCredit = 0.0
+    private val line = ByteArrayOutputStream()
+    @Volatile private var stopping = false
+    private var fd: FileDescriptor? = null
+    private var reader: Thread? = null
+
+    fun start() {
+        startedAt = SystemClock.elapsedRealtime()
+        File(fifoPath).delete()
+        Os.mkfifo(fifoPath, 384) // 0600
+        // NOTE: See the same trick in ErrorLogBuffer.start().
+        fd = Os.open(fifoPath, OsConstants.O_RDWR or OsConstants.O_NONBLOCK, 0)
+        reader = thread(name = "RNSS access log reader") { read() }
+    }
+
+    /**
+     * Parses the remaining log content, and stops the reader thread;
+     * the records are kept in the ring, and can still be exported.
+     */
+    fun stop() {
+        stopping = true
+        reader?.join()
+        reader = null
+        fd?.let {
+            Os.close(it)
+            File(fifoPath).delete()
+        }
+        fd = null
+    }
+
+    /**
+     * Writes the ring content, oldest records first, into the file at path;
+     * returns the count of written records.
+     */
+    fun export(path: String): Int {
+        synchronized(lock) {
+            val count = minOf(written, capacity.toLong()).toInt()
+            val header = ByteBuffer.allocate(HEADER_SIZE)
+                    .order(ByteOrder.LITTLE_ENDIAN)
+                    .put(MAGIC.toByteArray())
+                    .putInt(RECORD_SIZE)
+                    .putInt(count)
+                    .putLong(seen)
+                    .putLong(written - count)
+            FileOutputStream(path).use { out ->
+                out.write(header.array())
+                val first = ((written - count) % capacity).toInt()
+                val array = ring.array()
+                val head = minOf(count, capacity - first)
+                out.write(array, first * RECORD_SIZE, head * RECORD_SIZE)
+                out.write(array, 0, (count - head) * RECORD_SIZE)
+            }
+            return count
+        }
+    }
+
+    /**
+     * Returns JSON with the request counters: the count of requests, bytes
+     * received and sent (with headers), counts of responses by status class
+     * (1xx - 5xx), counts of requests by handling time (LATENCY_BOUNDS_US
+     * ranges), and the time (s) since start().
+     */
+    fun stats(): String {
+        synchronized(lock) {
+            val uptime = (SystemClock.elapsedRealtime() - startedAt) / 1000
+            return "{\"requests\":$seen,\"bytesIn\":$bytesIn," +
+                    "\"bytesOut\":$bytesOut," +
+                    "\"statuses\":[${statuses.joinToString(",")}]," +
+                    "\"latency\":[${latency.joinToString(",")}]," +
+                    "\"uptime\":$uptime}"
+        }
+    }
+
+    private fun read() {
+        val fd = this.fd!!
+        val buf = ByteArray(READ_CHUNK_SIZE)
+        val pollFd = StructPollfd()
+        pollFd.fd = fd
+        pollFd.events = OsConstants.POLLIN.toShort()
+        try {
+            while (true) {
+                val n = try {
+                    Os.read(fd, buf, 0, buf.size)
+                } catch (e: ErrnoException) {
+                    if (e.errno != OsConstants.EAGAIN) throw e
+                    0
+                }
+                if (n > 0) {
+                    for (i in 0 until n) {
+                        if (buf[i] == NEW_LINE) {
+                            parse(line.toString(Charsets.ISO_8859_1.name()))
+                            line.reset()
+                        } else if (line.size() < MAX_LINE_SIZE) line.write(buf[i].toInt())
+                    }
+                } else if (stopping) break
+                else Os.poll(arrayOf(pollFd), POLL_INTERVAL_MS)
+            }
+        } catch (e: Exception) {
+            Log.e(LOG_TAG, "Failed to read the access log", e)
+        }
+    }
+
+    /**
+     * Parses a log line in the format
+     * "<time> <duration> <status> <bytes> <bytes in> <bytes out> <path>"
+     * (see src/accessLog.ts), accounts it in the counters, and adds it to
+     * the ring, if sampled. Requests to the library's internal URL paths
+     * (e.g. the status page) are skipped.
+     * NOTE: The line is decoded as ISO-8859-1, to hash the original bytes
+     * of the path (see hashPath()).
+     */
+    private fun parse(line: String) {
+        val fields = line.split(' ', limit = 7)
+        fun num(i: Int) = fields.getOrNull(i)?.toLongOrNull() ?: 0L
+        val path = fields.getOrElse(6) { "" }
+        if (path.startsWith(INTERNAL_PATH_PREFIX)) return
+        val duration = num(1)
+        val status = num(2).toInt()
+        val hash = hashPath(path)
+
+        synchronized(lock) {
+            ++seen
+            bytesIn += num(4)
+            bytesOut += num(5)
+            if (status in 100 until 100 * (STATUS_CLASSES + 1)) {
+                ++statuses[status / 100 - 1]
+            }
+            var bucket = 0
+            while (bucket < LATENCY_BOUNDS_US.size
+                    && duration > LATENCY_BOUNDS_US[bucket]) ++bucket
+            ++latency[bucket]
+
+            sampleCredit += sampleRate
+            if (sampleCredit < 1 || capacity == 0) return
+            sampleCredit -= 1
+            ring.position((written++ % capacity).toInt() * RECORD_SIZE)
+            ring.putInt(num(0).toInt())
+                    .putInt(num(1).toInt())
+                    .putInt(num(3).toInt()) // NOTE: "-" for empty responses.
+                    .putInt(hash)
+                    .putShort(status.toShort())
+                    .put(if (status == 304) CACHE_REVALIDATED else CACHE_NONE)
+                    .put(0.toByte())
+        }
+    }
+
+    /**
+     * FNV-1a hash of the URL path, as logged by mod_accesslog, with its
+     * escape sequences decoded; mod_accesslog escapes non-printable bytes,
+     * bytes above 0x7E, double quotes, and backslashes in the path. Thus,
+     * the hash is taken from the original path bytes, matching hashPath()
+     * in src/accessLog.ts.
+     */
+    private fun hashPath(path: String): Int {
+        var hash = FNV_OFFSET_BASIS
+        var i = 0
+        while (i < path.length) {
+            var c = path[i++].code
+            if (c == '\\'.code && i < path.length) {
+                val hi = if (path[i] == 'x' && i + 2 < path.length) {
+                    Character.digit(path[i + 1], 16)
+                } else -1
+                val lo = if (hi >= 0) Character.digit(path[i + 2], 16) else -1
+                val escape = ESCAPES.indexOf(path[i])
+                if (lo >= 0) {
+                    c = 16 * hi + lo
+                    i += 3
+                } else if (escape >= 0) {
+                    c = UNESCAPED[escape].code
+                    ++i
+                }
+            }
+            hash = (hash xor c) * FNV_PRIME
+        }
+        return hash
+    }
+
+    companion object {
+        const val CACHE_NONE: Byte = 0
+        const val CACHE_REVALIDATED: Byte = 1 // 304 Not Modified.
+
+        // Escape sequences of mod_accesslog, besides "\xHH", and the characters
+        // they stand for.
+        const val ESCAPES = "\"\\btnvr"
+        const val UNESCAPED = "\"\\\b\t\n\u000B\r"
+
+        const val FNV_OFFSET_BASIS = -2128831035 // 2166136261
+        const val FNV_PRIME = 16777619
+        const val HEADER_SIZE = 32
+
+        // NOTE: It must match STATUS_URL_PREFIX in src/stats.ts.
+        const val INTERNAL_PATH_PREFIX = "/.rn-static-server/"
+
+        // Upper bounds (us) of request handling time ranges counted by
+        // stats(); the last range is unbounded.
+        // NOTE: They must match LATENCY_BOUNDS in src/stats.ts.
+        val LATENCY_BOUNDS_US = longArrayOf(
+                1000, 5000, 10000, 50000, 100000, 500000, 1000000)
+
+        const val LOG_TAG = Errors.LOG_TAG + " (AccessLogBuffer)"
+        const val MAGIC = "RNSSAL01"
+        const val NEW_LINE = '\n'.code.toByte()
+        const val POLL_INTERVAL_MS = 250
+        const val READ_CHUNK_SIZE = 16384
+        const val RECORD_SIZE = 20
+        const val STATUS_CLASSES = 5 // 1xx - 5xx.
+
+        // Max length of a log line; longer lines (i.e. huge URL paths) are cut,
+        // which only affects their path hashes.
+        const val MAX_LINE_SIZE = 4096
+    }
+}
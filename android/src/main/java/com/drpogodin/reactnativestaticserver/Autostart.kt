@@ -0,0 +1,106 @@
+package com.drpogodin.reactnativestaticserver
+
+import android.content.Context
+import android.content.pm.PackageManager
+import android.os.Process
+import android.system.Os
+import android.util.Log
+import com.lighttpd.Server
+import java.io.File
+
+/**
+ * Native autostart of the server, to launch it from Application.onCreate(),
+ * in parallel with React Native boot, rather than after the JS bundle has
+ * loaded, and called StaticServer.start(). The JS layer later adopts
+ * the running server (see "Native Autostart" in README.md).
+ *
+ * It is opted in by the app manifest meta-data, inside <application> tag:
+ * - ReactNativeStaticServer_autostartConfig - Path of Lighttpd config file,
+ *   inside the app assets;
+ * - ReactNativeStaticServer_autostartId - Optional. Server ID, for the JS
+ *   layer; defaults 1.
+ *
+ * The config may refer to RNSS_DOCUMENT_DIR and RNSS_WORK_DIR environment
+ * variables (as env.RNSS_DOCUMENT_DIR, etc.), which are set to the absolute
+ * paths of DocumentDirectoryPath, and the library's WORK_DIR.
+ */
+object Autostart {
+    const val CONFIG_KEY = "ReactNativeStaticServer_autostartConfig"
+    const val DEFAULT_ID = 1.0
+    const val ID_KEY = "ReactNativeStaticServer_autostartId"
+    const val LOG_TAG = Errors.LOG_TAG + " (Autostart)"
+
+    // NOTE: All fields below are guarded by this object.
+    private var server: Server? = null
+    private var launchDetails: String? = null
+    private var signalHandler: ((Server, String, String?) -> Unit)? = null
+
+    /**
+     * Launches the server, if opted in by the app manifest; it does not wait
+     * for the launch, and it does nothing if called again.
+     */
+    @JvmStatic fun start(context: Context) {
+        try {
+            val info = context.packageManager.getApplicationInfo(
+                    context.packageName, PackageManager.GET_META_DATA)
+            val meta = info.metaData ?: return
+            val asset = meta.getString(CONFIG_KEY) ?: return
+            val id = meta.getInt(ID_KEY, DEFAULT_ID.toInt()).toDouble()
+
+            // NOTE: These must match DocumentDirectoryPath and WORK_DIR
+            // of the JS layer.
+            val workDir = File(context.cacheDir, "__rn-static-server__")
+            File(workDir, "uploads").mkdirs()
+            Os.setenv("RNSS_DOCUMENT_DIR", context.filesDir.absolutePath, true)
+            Os.setenv("RNSS_WORK_DIR", workDir.absolutePath, true)
+
+            val config = File(workDir, "autostart-config.txt")
+            context.assets.open(asset).use { input ->
+                config.outputStream().use { input.copyTo(it) }
+            }
+
+            synchronized(this) {
+                if (server != null) return
+                lateinit var instance: Server
+                instance = Server(id, config.absolutePath, "", 0, 0, 1.0,
+                        false, Process.THREAD_PRIORITY_DISPLAY,
+                        { signal, details -> onSignal(instance, signal, details) })
+                server = instance
+                instance.start()
+            }
+        } catch (e: Exception) {
+            Log.e(LOG_TAG, "Failed to autostart the server", e)
+        }
+    }
+
+    /**
+     * Hands the autostarted server, if it is still running, over to the given
+     * signal handler, which receives all its subsequent signals. Returns
+     * the server, and its launch details (null if it is still starting).
+     */
+    fun adopt(handler: (Server, String, String?) -> Unit): Pair<Server, String?>? {
+        synchronized(this) {
+            val instance = server ?: return null
+            signalHandler = handler
+            return Pair(instance, launchDetails)
+        }
+    }
+
+    private fun onSignal(source: Server, signal: String, details: String?) {
+        val handler: ((Server, String, String?) -> Unit)?
+        synchronized(this) {
+            handler = signalHandler
+            if (handler == null) {
+                if (signal == Server.LAUNCHED) launchDetails = details
+                else {
+                    Log.e(LOG_TAG, "Autostarted server exited: $signal $details")
+                    server = null
+                }
+            } else if (signal != Server.LAUNCHED) {
+                server = null
+                signalHandler = null
+            }
+        }
+        handler?.invoke(source, signal, details)
+    }
+}
@@ -0,0 +1,199 @@
+package com.drpogodin.reactnativestaticserver
+
+import android.system.ErrnoException
+import android.system.Os
+import android.system.OsConstants
+import android.system.StructPollfd
+import android.util.Log
+import java.io.File
+import java.io.FileDescriptor
+import java.io.FileOutputStream
+import kotlin.concurrent.thread
+
+/**
+ * Asynchronous buffered sink for the server error log.
+ *
+ * Lighttpd is given the path of a FIFO (fifoPath) as its error log,
+ * the reader thread drains that FIFO into a bounded in-memory ring,
+ * and the flusher thread appends the ring content to the actual log file
+ * (logPath) in large batched writes; or, if logPath is null, it passes
+ * batches of complete log lines to logConsumer. Thus, the server thread only
+ * writes into the pipe buffer in memory, and never waits for the storage,
+ * nor for the log consumer.
+ *
+ * If the ring overflows, the excess log bytes are dropped, and counted;
+ * the count of dropped bytes is noted in the log with the next flush.
+ */
+class ErrorLogBuffer(
+        val fifoPath: String,
+        capacity: Int,
+        private val logPath: String?,
+        private val logConsumer: ((lines: String) -> Unit)?
+) {
+    // The flusher coalesces the log for its interval, and it is woken up
+    // ahead of time only once the free space in the ring may not fit the next
+    // read from the FIFO, i.e. the ring is about to overflow.
+    private val overflowMargin = minOf(READ_CHUNK_SIZE, capacity / 2)
+
+    // NOTE: All fields below are guarded by the lock.
+    private val lock = Object()
+    private val ring = ByteArray(capacity)
+    private var ringStart = 0
+    private var ringSize = 0
+    private var dropped = 0L
+    private var flushRequested = false
+    private var readerDone = false
+
+    @Volatile private var stopping = false
+    private var fd: FileDescriptor? = null
+    private var flusher: Thread? = null
+    private var reader: Thread? = null
+
+    fun start() {
+        File(fifoPath).delete()
+        Os.mkfifo(fifoPath, 384) // 0600
+        // NOTE: Opening the FIFO for both reading and writing does not block,
+        // and the reads never report EOF, no matter whether Lighttpd has
+        // the FIFO open or not.
+        fd = Os.open(fifoPath, OsConstants.O_RDWR or OsConstants.O_NONBLOCK, 0)
+        reader = thread(name = "RNSS error log reader") { read() }
+        flusher = thread(name = "RNSS error log flusher") { flush() }
+    }
+
+    /**
+     * Drains the remaining log content into the file, and releases resources.
+     * It should be called once the server has terminated.
+     */
+    fun stop() {
+        stopping = true
+        reader?.join()
+        flusher?.join()
+        fd?.let { Os.close(it) }
+        File(fifoPath).delete()
+    }
+
+    /**
+     * Wakes up the flusher thread to flush the buffered log right away, e.g.
+     * on memory pressure, when the app may be killed soon.
+     */
+    fun flushNow() {
+        synchronized(lock) {
+            flushRequested = true
+            lock.notifyAll()
+        }
+    }
+
+    // NOTE: It must be called with the lock held.
+    private fun nearlyFull() = ring.size - ringSize < overflowMargin
+
+    private fun read() {
+        val fd = this.fd!!
+        val buf = ByteArray(READ_CHUNK_SIZE)
+        val pollFd = StructPollfd()
+        pollFd.fd = fd
+        pollFd.events = OsConstants.POLLIN.toShort()
+        try {
+            while (true) {
+                val n = try {
+                    Os.read(fd, buf, 0, buf.size)
+                } catch (e: ErrnoException) {
+                    if (e.errno != OsConstants.EAGAIN) throw e
+                    0
+                }
+                if (n > 0) push(buf, n)
+                else if (stopping) break
+                else Os.poll(arrayOf(pollFd), POLL_INTERVAL_MS)
+            }
+        } catch (e: Exception) {
+            Log.e(LOG_TAG, "Failed to read the error log", e)
+        }
+        synchronized(lock) {
+            readerDone = true
+            lock.notifyAll()
+        }
+    }
+
+    private fun push(buf: ByteArray, n: Int) {
+        synchronized(lock) {
+            val size = minOf(n, ring.size - ringSize)
+            val end = (ringStart + ringSize) % ring.size
+            val head = minOf(size, ring.size - end)
+            System.arraycopy(buf, 0, ring, end, head)
+            System.arraycopy(buf, head, ring, 0, size - head)
+            ringSize += size
+            dropped += n - size
+            if (nearlyFull()) lock.notifyAll()
+        }
+    }
+
+    /**
+     * Takes out of the ring its content, or, if wholeLines is set,
+     * its content up to the last line end (unless the ring is nearly full,
+     * or the reader is done).
+     */
+    private fun take(wholeLines: Boolean): ByteArray {
+        var size = ringSize
+        if (wholeLines && !readerDone && !nearlyFull()) {
+            while (size > 0 && ring[(ringStart + size - 1) % ring.size] != NEW_LINE) {
+                --size
+            }
+        }
+        val chunk = ByteArray(size)
+        val head = minOf(size, ring.size - ringStart)
+        System.arraycopy(ring, ringStart, chunk, 0, head)
+        System.arraycopy(ring, 0, chunk, head, size - head)
+        ringStart = (ringStart + size) % ring.size
+        ringSize -= size
+        return chunk
+    }
+
+    private fun flush() {
+        val out = logPath?.let { FileOutputStream(it, true) }
+        val interval = if (out == null) STREAM_INTERVAL_MS else FLUSH_INTERVAL_MS
+        try {
+            while (true) {
+                var chunk: ByteArray
+                var drops: Long
+                var done: Boolean
+                synchronized(lock) {
+                    val deadline = System.nanoTime() + interval * 1000000
+                    while (!readerDone && !flushRequested && !nearlyFull()) {
+                        val left = (deadline - System.nanoTime()) / 1000000
+                        if (left <= 0) break
+                        lock.wait(left)
+                    }
+                    flushRequested = false
+                    done = readerDone
+                    chunk = take(out == null)
+                    drops = dropped
+                    dropped = 0
+                }
+                val note = if (drops > 0) {
+                    "(RN Static Server: $drops bytes of error log dropped)\n"
+                } else ""
+                if (out != null) {
+                    if (chunk.isNotEmpty()) out.write(chunk)
+                    if (note.isNotEmpty()) out.write(note.toByteArray())
+                } else if (chunk.isNotEmpty() || note.isNotEmpty()) {
+                    logConsumer?.invoke(String(chunk, Charsets.UTF_8) + note)
+                }
+                if (done) break
+            }
+        } catch (e: Exception) {
+            Log.e(LOG_TAG, "Failed to write the error log", e)
+        } finally {
+            out?.close()
+        }
+    }
+
+    companion object {
+        const val FLUSH_INTERVAL_MS = 1000L
+        const val LOG_TAG = Errors.LOG_TAG + " (ErrorLogBuffer)"
+        const val NEW_LINE = '\n'.code.toByte()
+        const val POLL_INTERVAL_MS = 250
+        const val READ_CHUNK_SIZE = 16384
+
+        // Max frequency of log batches passed to logConsumer.
+        const val STREAM_INTERVAL_MS = 250L
+    }
+}
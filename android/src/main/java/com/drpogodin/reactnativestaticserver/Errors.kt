@@ -47,6 +47,20 @@ class Errors(val name: String, val message: String) {
                 "Failed to launch server #$failedToLaunchServerId, another server instance (#$activeServerId) is active.")
         }
 
+        fun failDumpTrace(): Errors {
+            return Errors(
+                "FAIL_DUMP_TRACE",
+                "Failed to dump the server trace"
+            )
+        }
+
+        fun failExportAccessLog(): Errors {
+            return Errors(
+                "FAIL_EXPORT_ACCESS_LOG",
+                "Failed to export the access log"
+            )
+        }
+
         fun failGetLocalIpAddress(): Errors {
             return Errors(
                 "FAIL_GET_LOCAL_IP_ADDRESS",
@@ -61,10 +75,23 @@ class Errors(val name: String, val message: String) {
             )
         }
 
+        fun failGetStats(): Errors {
+            return Errors(
+                "FAIL_GET_STATS",
+                "Failed to get server stats"
+            )
+        }
+
         fun internalError(serverId: Double): Errors {
             return Errors("INTERNAL_ERROR", "Internal error (server #$serverId)")
         }
 
+        fun startCancelled(serverId: Double): Errors {
+            return Errors(
+                "START_CANCELLED",
+                "Launch of server #$serverId was cancelled by a stop request")
+        }
+
         fun serverCrashed(serverId: Double): Errors {
             return Errors("SERVER_CRASHED", "Server #$serverId crashed")
         }
@@ -1,5 +1,9 @@
 package com.drpogodin.reactnativestaticserver
 
+import android.app.ActivityManager
+import android.content.ComponentCallbacks2
+import android.content.Context
+import android.content.res.Configuration
 import android.util.Log
 import com.drpogodin.reactnativestaticserver.InetAddressUtils.isIPv4Address
 import com.facebook.react.bridge.Arguments
@@ -10,35 +14,155 @@ import com.facebook.react.bridge.ReactMethod
 import com.facebook.react.module.annotations.ReactModule
 import com.facebook.react.modules.core.DeviceEventManagerModule
 import com.lighttpd.Server
+import com.lighttpd.Trace
+import java.io.File
 import java.net.InetAddress
 import java.net.NetworkInterface
 import java.net.ServerSocket
-import java.util.concurrent.Semaphore
+import java.security.SecureRandom
 
 @ReactModule(name = ReactNativeStaticServerModule.NAME)
 class ReactNativeStaticServerModule(reactContext: ReactApplicationContext) :
-  NativeReactNativeStaticServerSpec(reactContext), LifecycleEventListener {
-    // The currently active server instance. We assume only single server instance
+  NativeReactNativeStaticServerSpec(reactContext), LifecycleEventListener,
+  ComponentCallbacks2 {
+    // NOTE: The server lifecycle is a state machine, with all fields below
+    // guarded by the lock; its transitions are triggered by start() and stop()
+    // calls, and by signals from the server thread. The lock is only held for
+    // the transitions themselves, and never while waiting for the server,
+    // thus start() and stop() never block the calling thread; their promises
+    // are queued, and settled by the server signals.
+    private val lock = Object()
+    private var state = State.IDLE
+
+    // The current server instance. We assume only single server instance
     // can be active at any time, thus a simple field should be enough for now.
-    // If we arrive to having possibility of multiple servers running in
-    // parallel, then this will become a hash map [ID <-> Server], and we will
-    // use it for communication from JS to this module to the target Server
-    // instance.
     private var server: Server? = null
-    private var pendingPromise: Promise? = null
+
+    private var launchDetails: String? = null
+    private val startPromises = mutableListOf<Promise>()
+    private val stopPromises = mutableListOf<Promise?>()
+
+    // Set when stop() is called while the server is starting; the server is
+    // stopped as soon as it is launched.
+    private var stopRequested = false
+
+    // The start request received while the server is stopping (or is to be
+    // stopped); it is launched once the current server terminates, i.e.
+    // start() during stop becomes a restart.
+    private var nextStart: StartRequest? = null
+
+    init {
+        // Adopts the server launched by Autostart.start(), if any, as if it
+        // was started by start() call.
+        synchronized(lock) {
+            Autostart.adopt { source, signal, details ->
+                val emitter: DeviceEventManagerModule.RCTDeviceEventEmitter = reactApplicationContext
+                        .getJSModule(DeviceEventManagerModule.RCTDeviceEventEmitter::class.java)
+                onSignal(source, emitter, signal, details)
+            }?.let { (instance, details) ->
+                Log.i(LOG_TAG, "Adopted autostarted server #${instance.id}")
+                server = instance
+                launchDetails = details
+                state = if (details == null) State.STARTING else State.ACTIVE
+            }
+        }
+        reactContext.applicationContext.registerComponentCallbacks(this)
+    }
+
+    override fun invalidate() {
+        reactApplicationContext.applicationContext
+                .unregisterComponentCallbacks(this)
+        super.invalidate()
+    }
+
+    override fun onTrimMemory(level: Int) {
+        // NOTE: UI_HIDDEN just means the app went to background.
+        if (level != ComponentCallbacks2.TRIM_MEMORY_UI_HIDDEN) {
+            synchronized(lock) { server }?.trimMemory()
+        }
+    }
+
+    override fun onLowMemory() {
+        synchronized(lock) { server }?.trimMemory()
+    }
+
+    override fun onConfigurationChanged(newConfig: Configuration) {}
 
     override fun getTypedExportedConstants(): Map<String, Any> {
         val constants: MutableMap<String, Any> = HashMap()
         constants["CRASHED"] = Server.CRASHED
+        constants["DEVICE_CORES"] = Runtime.getRuntime().availableProcessors()
+        constants["DEVICE_FD_LIMIT"] = fdLimit()
+        constants["DEVICE_RAM"] = totalRam()
         constants["IS_MAC_CATALYST"] = false
         constants["LAUNCHED"] = Server.LAUNCHED
+        constants["LOG"] = Server.LOG
         constants["TERMINATED"] = Server.TERMINATED
         return constants
     }
 
+    // Returns the soft limit of open file descriptors of the app process,
+    // or 0 if unknown.
+    private fun fdLimit(): Double {
+        try {
+            val line = File("/proc/self/limits").readLines()
+                    .firstOrNull { it.startsWith("Max open files") }
+            if (line != null) {
+                return line.substring(FD_LIMIT_COLUMN).trim()
+                        .split(Regex("\\s+"))[0].toDoubleOrNull() ?: 0.0
+            }
+        } catch (e: Exception) {
+            Log.w(LOG_TAG, "Failed to read the file descriptors limit", e)
+        }
+        return 0.0
+    }
+
+    // Returns the total RAM of the device (bytes).
+    private fun totalRam(): Double {
+        val manager = reactApplicationContext
+                .getSystemService(Context.ACTIVITY_SERVICE) as ActivityManager
+        val info = ActivityManager.MemoryInfo()
+        manager.getMemoryInfo(info)
+        return info.totalMem.toDouble()
+    }
+
+    @ReactMethod
+    override fun dumpTrace(dir: String, promise: Promise) {
+        try {
+            promise.resolve(Trace.dump(dir))
+        } catch (e: Exception) {
+            Errors.failDumpTrace().log(e).reject(promise, e.message)
+        }
+    }
+
+    @ReactMethod
+    override fun exportAccessLog(path: String, promise: Promise) {
+        try {
+            val log = synchronized(lock) { server }?.accessLog
+                    ?: throw Exception("No active server with access log")
+            promise.resolve(log.export(path))
+        } catch (e: Exception) {
+            Errors.failExportAccessLog().log(e).reject(promise, e.message)
+        }
+    }
+
+    @ReactMethod
+    override fun getStats(promise: Promise) {
+        val stats = synchronized(lock) { server }?.stats()
+        if (stats != null) promise.resolve(stats)
+        else Errors.failGetStats().reject(promise, "No active server with stats")
+    }
+
     @ReactMethod
     override fun getActiveServerId(promise: Promise) {
-      promise.resolve(server?.id)
+      promise.resolve(synchronized(lock) { server }?.id)
+    }
+
+    @ReactMethod
+    override fun getRandomToken(promise: Promise) {
+        val bytes = ByteArray(RANDOM_TOKEN_SIZE)
+        SecureRandom().nextBytes(bytes)
+        promise.resolve(bytes.joinToString("") { "%02x".format(it) })
     }
 
     @ReactMethod
@@ -74,49 +198,119 @@ class ReactNativeStaticServerModule(reactContext: ReactApplicationContext) :
             id: Double,  // Server ID for backward communication with JS layer.
             configPath: String,
             errlogPath: String,
+            errlogBufferSize: Double,
+            accessLogCapacity: Double,
+            accessLogSampleRate: Double,
+            stats: Boolean,
+            threadPriority: String,
+            bigCores: Boolean, // NOTE: Not supported on Android, ignored.
             promise: Promise
     ) {
         Log.i(LOG_TAG, "Starting...")
-        try {
-            sem.acquire()
-        } catch (e: Exception) {
-            Errors.internalError(id).log(e)
-                    .reject(promise, "Failed to acquire a semaphore")
-            return
+        val request = StartRequest(id, configPath, errlogPath,
+                errlogBufferSize.toInt(), accessLogCapacity.toInt(),
+                accessLogSampleRate, stats,
+                Server.threadPriority(threadPriority))
+        var error: Errors? = null
+        var details: String? = null
+        synchronized(lock) {
+            val pending = nextStart
+            when {
+                state == State.STOPPING || stopRequested -> {
+                    if (pending != null && pending.id != id) {
+                        error = Errors.anotherInstanceIsActive(pending.id, id)
+                    } else {
+                        nextStart = (pending ?: request)
+                                .also { it.promises.add(promise) }
+                    }
+                }
+                state == State.IDLE -> {
+                    launch(request)
+                    startPromises.add(promise)
+                }
+                server!!.id != id -> {
+                    error = Errors.anotherInstanceIsActive(server!!.id, id)
+                }
+                state == State.STARTING -> startPromises.add(promise)
+                else -> details = launchDetails
+            }
         }
+        if (error != null) error!!.log().reject(promise)
+        else if (details != null) promise.resolve(details)
+    }
 
-        val activeServerId = server?.id
-        if (activeServerId != null) {
-            Errors.anotherInstanceIsActive(activeServerId, id).log().reject(promise)
-            sem.release()
-            return
-        }
-        if (pendingPromise != null) {
-            Errors.internalError(id).log().reject(promise, "Unexpected pending promise")
-            sem.release()
-            return
-        }
-        pendingPromise = promise
+    // Launches a new server; it must be called with the lock held.
+    private fun launch(request: StartRequest) {
         val emitter: DeviceEventManagerModule.RCTDeviceEventEmitter = reactApplicationContext
                 .getJSModule(DeviceEventManagerModule.RCTDeviceEventEmitter::class.java)
+        val id = request.id
+        lateinit var instance: Server
+        instance = Server(id, request.configPath, request.errlogPath,
+                request.errlogBufferSize, request.accessLogCapacity,
+                request.accessLogSampleRate, request.stats,
+                request.threadPriority,
+                { signal, details ->
+            onSignal(instance, emitter, signal, details)
+        }) { lines ->
+            val event = Arguments.createMap()
+            event.putDouble("serverId", id)
+            event.putString("event", Server.LOG)
+            event.putString("details", lines)
+            emitter.emit("RNStaticServer", event)
+        }
+        server = instance
+        state = State.STARTING
+        launchDetails = null
+        instance.start()
+    }
 
-        server = Server(id, configPath, errlogPath) { signal, details ->
-            if (signal !== Server.LAUNCHED) server = null
-            if (pendingPromise == null) {
-                val event = Arguments.createMap()
-                event.putDouble("serverId", id)
-                event.putString("event", signal)
-                event.putString("details", details)
-                emitter.emit("RNStaticServer", event)
+    private fun onSignal(
+            source: Server,
+            emitter: DeviceEventManagerModule.RCTDeviceEventEmitter,
+            signal: String,
+            details: String?
+    ) {
+        var starts = listOf<Promise>()
+        var stops = listOf<Promise?>()
+        synchronized(lock) {
+            if (source !== server) return
+            starts = startPromises.toList()
+            startPromises.clear()
+            if (signal == Server.LAUNCHED) {
+                state = State.ACTIVE
+                launchDetails = details
+                if (stopRequested) {
+                    stopRequested = false
+                    state = State.STOPPING
+                    source.interrupt()
+                }
             } else {
-                if (signal === Server.CRASHED) {
-                    Errors.serverCrashed(id).reject(pendingPromise, details)
-                } else pendingPromise!!.resolve(details)
-                pendingPromise = null
-                sem.release()
+                state = State.IDLE
+                server = null
+                stopRequested = false
+                stops = stopPromises.toList()
+                stopPromises.clear()
+                nextStart?.let {
+                    nextStart = null
+                    launch(it)
+                    startPromises.addAll(it.promises)
+                }
             }
         }
-        server!!.start()
+
+        if (starts.isEmpty() && stops.isEmpty()) {
+            val event = Arguments.createMap()
+            event.putDouble("serverId", source.id)
+            event.putString("event", signal)
+            event.putString("details", details)
+            emitter.emit("RNStaticServer", event)
+        } else if (signal == Server.CRASHED) {
+            starts.forEach { Errors.serverCrashed(source.id).reject(it, details) }
+            stops.forEach { Errors.serverCrashed(source.id).reject(it, details) }
+        } else {
+            starts.forEach { it.resolve(details) }
+            stops.forEach { it?.resolve(details) }
+        }
     }
 
     @ReactMethod
@@ -135,21 +329,28 @@ class ReactNativeStaticServerModule(reactContext: ReactApplicationContext) :
     @ReactMethod
     override fun stop(promise: Promise?) {
         Log.i(LOG_TAG, "stop() triggered")
-        try {
-            sem.acquire()
-        } catch (e: Exception) {
-            Errors.internalError(server!!.id).log(e)
-                    .reject(promise, "Failed to acquire a semaphore")
-            return
+        var cancelled: StartRequest? = null
+        var stopped = false
+        synchronized(lock) {
+            cancelled = nextStart
+            nextStart = null
+            when (state) {
+                State.IDLE -> stopped = true
+                State.STARTING -> stopRequested = true
+                State.ACTIVE -> {
+                    state = State.STOPPING
+                    server!!.interrupt()
+                }
+                State.STOPPING -> {}
+            }
+            if (!stopped) stopPromises.add(promise)
         }
-        if (pendingPromise != null) {
-            Errors.internalError(server!!.id)
-                    .reject(pendingPromise, "Unexpected pending promise")
-            sem.release()
-            return
+        cancelled?.let { request ->
+            request.promises.forEach {
+                Errors.startCancelled(request.id).reject(it)
+            }
         }
-        pendingPromise = promise
-        server!!.interrupt()
+        if (stopped) promise?.resolve(null)
     }
 
     @ReactMethod
@@ -169,16 +370,29 @@ class ReactNativeStaticServerModule(reactContext: ReactApplicationContext) :
         stop(null)
     }
 
+    private enum class State { IDLE, STARTING, ACTIVE, STOPPING }
+
+    private class StartRequest(
+            val id: Double,
+            val configPath: String,
+            val errlogPath: String,
+            val errlogBufferSize: Int,
+            val accessLogCapacity: Int,
+            val accessLogSampleRate: Double,
+            val stats: Boolean,
+            val threadPriority: Int
+    ) {
+        val promises = mutableListOf<Promise>()
+    }
+
     companion object {
-        // This semaphore is used to atomize server start-up and shut-down operations.
-        // It is acquired in the very beginning of start() and stop() methods; and it
-        // is normally released on the first subsequent signal from the server, at
-        // the same moment the pendingPromise for those start() and stop() is resolved.
-        // In edge cases, when start() or stop() is aborted due to failed runtime
-        // invariant checks, this semaphore is released at those abort points, which
-        // are in all cases prior to assigning the pendingPromise value.
-        private val sem = Semaphore(1, true)
         const val NAME = "ReactNativeStaticServer"
+
+        // The offset of "Soft Limit" column in /proc/self/limits.
+        const val FD_LIMIT_COLUMN = 26
         const val LOG_TAG = Errors.LOG_TAG + " (Module)"
+
+        // The size (bytes) of tokens generated by getRandomToken().
+        const val RANDOM_TOKEN_SIZE = 16
     }
 }
@@ -1,6 +1,9 @@
 package com.lighttpd
 
+import android.os.Process
 import android.util.Log
+import com.drpogodin.reactnativestaticserver.AccessLogBuffer
+import com.drpogodin.reactnativestaticserver.ErrorLogBuffer
 import com.drpogodin.reactnativestaticserver.Errors
 
 /**
@@ -24,8 +27,54 @@ class Server(
         val id: Double,
         var configPath: String,
         private var errorLogPath: String,
-        private val signalConsumer: (signal: String, message: String?) -> Unit
+
+        // If positive, the error log is written asynchronously, via
+        // ErrorLogBuffer of this size (bytes), into errorLogPath, if set;
+        // otherwise the log is streamed to logConsumer.
+        private val errorLogBufferSize: Int,
+
+        // If positive, the sampled binary access log is kept, via
+        // AccessLogBuffer of this size (records).
+        private val accessLogCapacity: Int,
+        private val accessLogSampleRate: Double,
+
+        // If set, the AccessLogBuffer is kept, even with zero capacity,
+        // for its request counters (see stats()).
+        private val stats: Boolean,
+
+        // The priority of the server thread, one of THREAD_PRIORITY_*
+        // constants of android.os.Process (see threadPriority()).
+        private val threadPriority: Int,
+
+        private val signalConsumer: (signal: String, message: String?) -> Unit,
+        private val logConsumer: ((lines: String) -> Unit)? = null
 ) : Thread() {
+    // Monotonic timestamps (ns) of the server launch phases, reported with
+    // LAUNCHED signal (see launchTimings()).
+    private val createdAt = System.nanoTime()
+    private var launchCalledAt = 0L
+    private var threadStartedAt = 0L
+
+    // NOTE: The module drops its reference to the server once it terminates,
+    // thus the log can be exported only while the server is active.
+    @Volatile var accessLog: AccessLogBuffer? = null
+        private set
+
+    @Volatile private var errorLog: ErrorLogBuffer? = null
+
+    /**
+     * Returns JSON with durations (ms) from this Server object creation
+     * (i.e. the native start() call) till the server thread start, till
+     * the native lighttpd_launch() call, and till LAUNCHED callback.
+     */
+    private fun launchTimings(): String {
+        val now = System.nanoTime()
+        fun ms(t: Long) = (t - createdAt) / 1e6
+        return "{\"threadStart\":${ms(threadStartedAt)}," +
+                "\"launchCall\":${ms(launchCalledAt)}," +
+                "\"launched\":${ms(now)}}"
+    }
+
     override fun interrupt() {
         Log.i(LOG_TAG, "Server.interrupt() triggered")
         gracefulShutdown()
@@ -34,19 +83,63 @@ class Server(
         // cause graceful termination of the thread.
     }
 
+    /**
+     * Returns JSON with the request counters of the server (see
+     * AccessLogBuffer.stats()), or null if it does not keep them.
+     */
+    fun stats(): String? = accessLog?.stats()
+
+    /**
+     * Responds to memory pressure: flushes the buffered error log, if any,
+     * as the app may be killed soon.
+     */
+    fun trimMemory() {
+        errorLog?.flushNow()
+    }
+
     private external fun gracefulShutdown()
     external fun launch(configPath: String, errorLogPath: String): Int
     override fun run() {
+        threadStartedAt = System.nanoTime()
         Log.i(LOG_TAG, "Server.run() triggered")
+        Process.setThreadPriority(threadPriority)
         if (activeServer != null) {
             val msg = "Another Server instance is active"
             Log.e(LOG_TAG, msg)
             signalConsumer(CRASHED, msg)
             return
         }
+        var logBuffer: ErrorLogBuffer? = null
         try {
             activeServer = this
-            val res = launch(configPath, errorLogPath)
+            var logPath = errorLogPath
+            if (errorLogBufferSize > 0) {
+                logBuffer = ErrorLogBuffer(
+                        "$configPath.errlog",
+                        errorLogBufferSize,
+                        logPath.ifEmpty { null },
+                        logConsumer)
+                logBuffer.start()
+                logPath = logBuffer.fifoPath
+                errorLog = logBuffer
+            }
+            if (accessLogCapacity > 0 || stats) {
+                // NOTE: The FIFO path must match the one in the config
+                // generated by the JS layer (see src/accessLog.ts).
+                val log = AccessLogBuffer(
+                        "$configPath.accesslog",
+                        accessLogCapacity,
+                        accessLogSampleRate)
+                log.start()
+                accessLog = log
+            }
+            Trace.traceThread()
+            launchCalledAt = System.nanoTime()
+            val res = launch(configPath, logPath)
+            errorLog = null
+            logBuffer?.stop()
+            logBuffer = null
+            accessLog?.stop()
             if (res != 0) {
                 throw Exception("Native server exited with status $res")
             }
@@ -57,6 +150,9 @@ class Server(
             Log.i(LOG_TAG, "Server terminated gracefully")
             signalConsumer(TERMINATED, null)
         } catch (error: Exception) {
+            errorLog = null
+            logBuffer?.stop()
+            accessLog?.stop()
             activeServer = null
             Log.e(LOG_TAG, "Server crashed", error)
             signalConsumer(CRASHED, error.message)
@@ -71,14 +167,26 @@ class Server(
         // NOTE: Tried to use enum, but was not able to make it work with JNI.
         const val CRASHED = "CRASHED"
         const val LAUNCHED = "LAUNCHED"
+        const val LOG = "LOG"
         const val TERMINATED = "TERMINATED"
         private var activeServer: Server? = null
         private const val LOG_TAG = Errors.LOG_TAG
 
+        /**
+         * Maps the thread priority name from the JS layer ("interactive",
+         * "default", or "utility") to the Android thread priority.
+         */
+        fun threadPriority(name: String): Int = when (name) {
+            "interactive" -> Process.THREAD_PRIORITY_DISPLAY
+            "utility" -> Process.THREAD_PRIORITY_BACKGROUND
+            else -> Process.THREAD_PRIORITY_DEFAULT
+        }
+
         // NOTE: @JvmStatic annotation is needed to make this function
         // visible via JNI in C code.
         @JvmStatic fun onLaunchedCallback() {
-            activeServer!!.signalConsumer(LAUNCHED, null)
+            val server = activeServer!!
+            server.signalConsumer(LAUNCHED, server.launchTimings())
         }
     }
 }
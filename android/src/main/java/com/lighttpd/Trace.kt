@@ -0,0 +1,40 @@
+package com.lighttpd
+
+/**
+ * Syscall-level tracing of the server thread into Chrome trace-event JSON
+ * (see host/trace.h). It is compiled into the native library only by builds
+ * with WITH_RNSS_TRACE CMake option, otherwise its native methods are missing,
+ * and the tracing is not available.
+ */
+object Trace {
+    init {
+        System.loadLibrary("lighttpd")
+    }
+
+    /**
+     * Enables tracing of the calling thread, if the tracing is available;
+     * does nothing otherwise.
+     */
+    fun traceThread() {
+        try {
+            thread()
+        } catch (e: UnsatisfiedLinkError) {
+            // NOOP
+        }
+    }
+
+    /**
+     * Writes the trace into a new file inside the given folder, and returns
+     * the file path.
+     */
+    fun dump(dir: String): String {
+        try {
+            return dumpTrace(dir)
+        } catch (e: UnsatisfiedLinkError) {
+            throw Exception("The library is built without WITH_RNSS_TRACE option")
+        }
+    }
+
+    @JvmStatic private external fun thread()
+    @JvmStatic private external fun dumpTrace(dir: String): String
+}
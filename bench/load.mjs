@@ -0,0 +1,125 @@
+// Closed-loop load generator: keeps the given number of requests in flight
+// for the given duration, over HTTP/1.1 (keep-alive connections) or h2c
+// (a single HTTP/2 connection with concurrent streams), and measures
+// throughput and latency percentiles.
+
+import http from "node:http";
+import http2 from "node:http2";
+
+/**
+ * @typedef {object} Request
+ * @prop {string} method
+ * @prop {string} path
+ * @prop {object} [headers]
+ * @prop {Buffer} [body]
+ * @prop {number[]} [expect] Acceptable status codes (default: [200]).
+ */
+
+function percentile(sorted, p) {
+  if (!sorted.length) return 0;
+  return sorted[Math.min(sorted.length - 1, Math.floor(p * sorted.length))];
+}
+
+function h1Client(origin, concurrency) {
+  const agent = new http.Agent({ keepAlive: true, maxSockets: concurrency });
+  return {
+    close: () => agent.destroy(),
+    request: ({ method, path, headers, body }) =>
+      new Promise((resolve, reject) => {
+        const req = http.request(
+          `${origin}${path}`,
+          { agent, headers, method },
+          (res) => {
+            let bytes = 0;
+            res.on("data", (chunk) => (bytes += chunk.length));
+            res.on("end", () => resolve({ bytes, status: res.statusCode }));
+            res.on("error", reject);
+          },
+        );
+        req.on("error", reject);
+        req.end(body);
+      }),
+  };
+}
+
+function h2Client(origin) {
+  const session = http2.connect(origin);
+  session.on("error", () => {});
+  return {
+    close: () => session.close(),
+    request: ({ method, path, headers, body }) =>
+      new Promise((resolve, reject) => {
+        const stream = session.request({
+          ":method": method,
+          ":path": path,
+          ...headers,
+        });
+        let bytes = 0;
+        let status = 0;
+        stream.on("response", (h) => (status = h[":status"]));
+        stream.on("data", (chunk) => (bytes += chunk.length));
+        stream.on("end", () => resolve({ bytes, status }));
+        stream.on("error", reject);
+        stream.end(body);
+      }),
+  };
+}
+
+/**
+ * Runs the load.
+ * @param {object} options
+ * @param {string} options.origin
+ * @param {"h1"|"h2c"} options.protocol
+ * @param {number} options.concurrency
+ * @param {number} options.durationMs
+ * @param {(i: number) => Request} options.next Returns i-th request to send.
+ */
+export async function runLoad({
+  concurrency,
+  durationMs,
+  next,
+  origin,
+  protocol,
+}) {
+  const client =
+    protocol === "h2c" ? h2Client(origin) : h1Client(origin, concurrency);
+
+  const latencies = [];
+  let bytes = 0;
+  let errors = 0;
+  let counter = 0;
+
+  const start = process.hrtime.bigint();
+  const deadline = start + BigInt(durationMs) * 1000000n;
+
+  const worker = async () => {
+    while (process.hrtime.bigint() < deadline) {
+      const req = next(counter++);
+      const t0 = process.hrtime.bigint();
+      try {
+        const res = await client.request(req);
+        if ((req.expect || [200]).includes(res.status)) {
+          latencies.push(Number(process.hrtime.bigint() - t0) / 1e6);
+          bytes += res.bytes + (req.body ? req.body.length : 0);
+        } else ++errors;
+      } catch {
+        ++errors;
+      }
+    }
+  };
+
+  await Promise.all(Array.from({ length: concurrency }, worker));
+  const elapsedS = Number(process.hrtime.bigint() - start) / 1e9;
+  client.close();
+
+  latencies.sort((a, b) => a - b);
+  return {
+    bytes,
+    errors,
+    mbPerSec: bytes / elapsedS / (1 << 20),
+    p50Ms: percentile(latencies, 0.5),
+    p99Ms: percentile(latencies, 0.99),
+    requests: latencies.length,
+    rps: latencies.length / elapsedS,
+  };
+}
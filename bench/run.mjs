@@ -0,0 +1,209 @@
+#!/usr/bin/env node
+
+// End-to-end HTTP benchmark of the native server, built for a Linux host
+// (see host/README.md). Run it with --help for usage.
+
+import { spawn } from "node:child_process";
+import { mkdtemp, readFile, rm, writeFile } from "node:fs/promises";
+import net from "node:net";
+import os from "node:os";
+import path from "node:path";
+import { parseArgs } from "node:util";
+
+import { runLoad } from "./load.mjs";
+import { extraConfig, makeScenarios } from "./scenarios.mjs";
+import { generateWebroot } from "./webroot.mjs";
+
+const HELP = `Usage: node bench/run.mjs [options]
+  --server <path>       rnss_host binary (default: build/host/rnss_host).
+  --out <path>          Where to write JSON results
+                        (default: bench-results.json).
+  --baseline <path>     JSON results of a previous run to compare against;
+                        the process exits with code 1 on regressions past
+                        the thresholds.
+  --thresholds <path>   Regression thresholds (default: bench/thresholds.json).
+  --duration <ms>       Duration of each case (default: 5000).
+  --concurrency <list>  Comma-separated concurrency levels (default: 1,8,32).
+  --protocols <list>    Comma-separated protocols (default: h1,h2c).
+  --scenarios <list>    Comma-separated scenarios (default: all).
+  --no-webdav           Skip WebDAV scenarios, for servers built without it.
+`;
+
+const { values: args } = parseArgs({
+  options: {
+    baseline: { type: "string" },
+    concurrency: { default: "1,8,32", type: "string" },
+    duration: { default: "5000", type: "string" },
+    help: { type: "boolean" },
+    "no-webdav": { type: "boolean" },
+    out: { default: "bench-results.json", type: "string" },
+    protocols: { default: "h1,h2c", type: "string" },
+    scenarios: { type: "string" },
+    server: { default: "build/host/rnss_host", type: "string" },
+    thresholds: {
+      default: path.join(import.meta.dirname, "thresholds.json"),
+      type: "string",
+    },
+  },
+});
+
+function getFreePort() {
+  return new Promise((resolve, reject) => {
+    const srv = net.createServer();
+    srv.on("error", reject);
+    srv.listen(0, "127.0.0.1", () => {
+      const { port } = srv.address();
+      srv.close(() => resolve(port));
+    });
+  });
+}
+
+/**
+ * Launches rnss_host, and resolves once it reports LAUNCHED signal.
+ */
+function launchServer(binary, argv) {
+  return new Promise((resolve, reject) => {
+    const proc = spawn(binary, argv, { stdio: ["ignore", "pipe", "inherit"] });
+    let out = "";
+    proc.on("error", reject);
+    proc.on("exit", (code) => reject(Error(`Server exited with code ${code}`)));
+    proc.stdout.on("data", (chunk) => {
+      out += chunk;
+      if (out.includes("LAUNCHED")) resolve(proc);
+      else if (out.includes("CRASHED")) reject(Error(out.trim()));
+    });
+  });
+}
+
+function stopServer(proc) {
+  return new Promise((resolve) => {
+    proc.removeAllListeners("exit");
+    proc.on("exit", resolve);
+    proc.kill("SIGTERM");
+  });
+}
+
+/**
+ * Compares results against the baseline, and returns the list of regressions.
+ */
+function findRegressions(results, baseline, thresholds) {
+  const regressions = [];
+  for (const [key, cur] of Object.entries(results.cases)) {
+    const base = baseline.cases[key];
+    if (!base) continue;
+    const scenario = key.split("/")[0];
+    const t = { ...thresholds.default, ...thresholds.scenarios?.[scenario] };
+    const check = (metric, limit, delta) => {
+      if (delta > limit) {
+        regressions.push(
+          `${key}: ${metric} ${base[metric].toFixed(2)} -> ` +
+            `${cur[metric].toFixed(2)} ` +
+            `(${(100 * delta).toFixed(1)}% > ${(100 * limit).toFixed(1)}%)`,
+        );
+      }
+    };
+    if (cur.errors > base.errors) {
+      regressions.push(`${key}: errors ${base.errors} -> ${cur.errors}`);
+    }
+    check("rps", t.maxThroughputDrop, (base.rps - cur.rps) / base.rps);
+    check("p50Ms", t.maxP50Increase, (cur.p50Ms - base.p50Ms) / base.p50Ms);
+    check("p99Ms", t.maxP99Increase, (cur.p99Ms - base.p99Ms) / base.p99Ms);
+  }
+  return regressions;
+}
+
+async function main() {
+  if (args.help) {
+    process.stdout.write(HELP);
+    return 0;
+  }
+
+  const tmp = await mkdtemp(path.join(os.tmpdir(), "rnss-bench-"));
+  const workDir = path.join(tmp, "work");
+  const webrootDir = path.join(tmp, "webroot");
+  const extraConfigFile = path.join(tmp, "extra.conf");
+
+  const webroot = await generateWebroot(webrootDir);
+  const webdav = !args["no-webdav"];
+  await writeFile(
+    extraConfigFile,
+    extraConfig(path.join(workDir, "uploads"), webdav),
+  );
+
+  const port = await getFreePort();
+  const origin = `http://127.0.0.1:${port}`;
+  const server = await launchServer(args.server, [
+    "--port",
+    `${port}`,
+    "--work-dir",
+    workDir,
+    "--extra-config",
+    extraConfigFile,
+    webrootDir,
+  ]);
+
+  const scenarios = makeScenarios(webroot);
+  let names = args.scenarios
+    ? args.scenarios.split(",")
+    : Object.keys(scenarios);
+  if (!webdav) names = names.filter((name) => name !== "webdav-put");
+
+  const results = {
+    cases: {},
+    date: new Date().toISOString(),
+    durationMs: Number(args.duration),
+    host: {
+      cpus: os.cpus().length,
+      platform: os.platform(),
+      release: os.release(),
+    },
+  };
+
+  try {
+    for (const name of names) {
+      const next = scenarios[name];
+      if (!next) throw Error(`Unknown scenario "${name}"`);
+      for (const protocol of args.protocols.split(",")) {
+        for (const c of args.concurrency.split(",").map(Number)) {
+          const key = `${name}/${protocol}/c${c}`;
+          const res = await runLoad({
+            concurrency: c,
+            durationMs: results.durationMs,
+            next,
+            origin,
+            protocol,
+          });
+          results.cases[key] = res;
+          console.log(
+            `${key.padEnd(28)} ${res.rps.toFixed(0).padStart(8)} req/s ` +
+              `${res.mbPerSec.toFixed(1).padStart(8)} MB/s ` +
+              `p50 ${res.p50Ms.toFixed(2).padStart(8)} ms ` +
+              `p99 ${res.p99Ms.toFixed(2).padStart(8)} ms ` +
+              `errors ${res.errors}`,
+          );
+        }
+      }
+    }
+  } finally {
+    await stopServer(server);
+    await rm(tmp, { force: true, recursive: true });
+  }
+
+  await writeFile(args.out, JSON.stringify(results, null, 2));
+  console.log(`Results written to ${args.out}`);
+
+  if (args.baseline) {
+    const baseline = JSON.parse(await readFile(args.baseline, "utf8"));
+    const thresholds = JSON.parse(await readFile(args.thresholds, "utf8"));
+    const regressions = findRegressions(results, baseline, thresholds);
+    if (regressions.length) {
+      console.error("Regressions detected:");
+      regressions.forEach((r) => console.error(`  ${r}`));
+      return 1;
+    }
+    console.log("No regressions against the baseline");
+  }
+  return 0;
+}
+
+process.exitCode = await main();
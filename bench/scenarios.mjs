@@ -0,0 +1,70 @@
+// Benchmark scenarios: each one maps the request counter to the request
+// to send, given the generated webroot content.
+
+import { randomBytes } from "node:crypto";
+
+const RANGE_SIZE = 256 << 10;
+const UPLOAD_SIZE = 64 << 10;
+
+/**
+ * @param {Awaited<ReturnType<import("./webroot.mjs").generateWebroot>>} webroot
+ * @returns {{[name: string]: (i: number) => import("./load.mjs").Request}}
+ */
+export function makeScenarios(webroot) {
+  const uploadBody = randomBytes(UPLOAD_SIZE);
+  return {
+    "small-files": (i) => ({
+      method: "GET",
+      path: webroot.small[i % webroot.small.length],
+    }),
+
+    bundles: (i) => ({
+      method: "GET",
+      path: webroot.bundles[i % webroot.bundles.length],
+    }),
+
+    "media-range": (i) => {
+      // Deterministic pseudo-random offsets, to keep runs comparable.
+      const blocks = Math.floor(webroot.mediaSize / RANGE_SIZE);
+      const from = ((i * 7919) % blocks) * RANGE_SIZE;
+      return {
+        expect: [206],
+        headers: { range: `bytes=${from}-${from + RANGE_SIZE - 1}` },
+        method: "GET",
+        path: webroot.media,
+      };
+    },
+
+    "webdav-put": (i) => ({
+      body: uploadBody,
+      expect: [200, 201, 204],
+      headers: { "content-length": `${UPLOAD_SIZE}` },
+      method: "PUT",
+      // A bounded set of targets keeps disk usage flat for long runs.
+      path: `/uploads/bench-${i % 256}.bin`,
+    }),
+
+    "dir-listing": () => ({ method: "GET", path: webroot.listing[0] }),
+  };
+}
+
+/**
+ * Lighttpd config to append to the standard one (via --extra-config option
+ * of rnss_host) to enable WebDAV uploads into UPLOADS_DIR, and directory
+ * listings used by the scenarios.
+ * @param {string} uploadsDir
+ * @param {boolean} webdav
+ */
+export function extraConfig(uploadsDir, webdav) {
+  const res = [
+    '$HTTP["url"] =~ "^/listing/" { dir-listing.activate = "enable" }',
+  ];
+  if (webdav) {
+    res.push(
+      'server.modules += ("mod_alias", "mod_webdav")',
+      `alias.url = ("/uploads/" => "${uploadsDir}/")`,
+      '$HTTP["url"] =~ "^/uploads/" { webdav.activate = "enable" }',
+    );
+  }
+  return res.join("\n");
+}
@@ -0,0 +1,60 @@
+// Generates the benchmark webroot, with content representative for apps
+// serving web content: many small files, a few multi-MB bundles, a media file
+// for range requests, and a large folder for directory listings.
+
+import { randomBytes } from "node:crypto";
+import { mkdir, writeFile } from "node:fs/promises";
+import path from "node:path";
+
+export const SMALL_FILES = 1000;
+export const BUNDLES = 4;
+export const BUNDLE_SIZE = 4 << 20;
+export const MEDIA_SIZE = 32 << 20;
+export const LISTING_ENTRIES = 500;
+
+/**
+ * Creates the webroot inside the given folder, and returns the lists of URL
+ * paths for different kinds of content within it.
+ * @param {string} root
+ */
+export async function generateWebroot(root) {
+  const small = [];
+  await mkdir(path.join(root, "assets"), { recursive: true });
+  for (let i = 0; i < SMALL_FILES; ++i) {
+    // 512B - 8KB, which is the typical range for icons, styles, and scripts
+    // of a web app split into chunks.
+    const size = 512 << i % 5;
+    const name = `assets/file-${i}.${["css", "js", "svg", "json"][i % 4]}`;
+    await writeFile(path.join(root, name), randomBytes(size).toString("hex"));
+    small.push(`/${name}`);
+  }
+
+  const bundles = [];
+  await mkdir(path.join(root, "bundles"), { recursive: true });
+  for (let i = 0; i < BUNDLES; ++i) {
+    const name = `bundles/bundle-${i}.js`;
+    await writeFile(path.join(root, name), randomBytes(BUNDLE_SIZE));
+    bundles.push(`/${name}`);
+  }
+
+  await mkdir(path.join(root, "media"), { recursive: true });
+  await writeFile(path.join(root, "media/video.mp4"), randomBytes(MEDIA_SIZE));
+
+  await mkdir(path.join(root, "listing"), { recursive: true });
+  for (let i = 0; i < LISTING_ENTRIES; ++i) {
+    await writeFile(path.join(root, `listing/entry-${i}.txt`), `${i}`);
+  }
+
+  await writeFile(
+    path.join(root, "index.html"),
+    "<html><body>Bench</body></html>",
+  );
+
+  return {
+    bundles,
+    listing: ["/listing/"],
+    media: "/media/video.mp4",
+    mediaSize: MEDIA_SIZE,
+    small,
+  };
+}
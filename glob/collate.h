@@ -11,7 +11,10 @@
  * memory on success and returns a null pointer and sets `errno` on failure
  * (but see the notes for malloc()).
  */
-#if __ANDROID_API__ >= 29
+#if !defined(__BIONIC__)
+/* Other C libraries (see host-compat.h) declare it in <stdlib.h>. */
+#include <stdlib.h>
+#elif __ANDROID_API__ >= 29
 void* _Nullable reallocarray(void* _Nullable __ptr, size_t __item_count, size_t __item_size) __BIONIC_ALLOC_SIZE(2, 3) __INTRODUCED_IN(29);
 #else
 #include <errno.h>
@@ -62,6 +62,12 @@ __FBSDID("$FreeBSD: head/lib/libc/gen/glob.c 317913 2017-05-07 19:52:56Z jilles
  *	expand ~user/foo to the /home/dir/of/user/foo
  * GLOB_BRACE:
  *	expand {1,2}{a,b} to 1a 1b 2a 2b
+ * GLOB_BYTESORT:
+ *	sort the results in byte order rather than by the collation order
+ *	of the current locale.
+ * GLOB_DIRCACHE:
+ *	read each directory once per glob() call, and reuse its entries for
+ *	all brace alternatives which descend into it.
  * gl_matchc:
  *	Number of matches in the current invocation of glob.
  */
@@ -105,14 +111,50 @@ __FBSDID("$FreeBSD: head/lib/libc/gen/glob.c 317913 2017-05-07 19:52:56Z jilles
 #define	GLOB_LIMIT_STAT		1024	/* number of stat system calls */
 #define	GLOB_LIMIT_STRING	ARG_MAX	/* maximum total size for paths */
 
+/*
+ * Entry names of a single directory, read with GLOB_DIRCACHE, kept in
+ * readdir(3) order as consequent NUL-terminated strings in `c_names`.
+ * A directory which does not exist is cached with no names.
+ */
+struct glob_dircache {
+	struct glob_dircache *c_next;	/* Next entry in the hash bucket. */
+	size_t	c_hash;
+	char	*c_names;
+	size_t	c_len;
+	char	c_path[];	/* Directory path, the cache key. */
+};
+
+/* Hash table of glob_dircache entries, keyed by directory paths. */
+struct glob_dircache_tab {
+	struct glob_dircache **t_buckets;
+	size_t	t_size;		/* Number of buckets, a power of two. */
+	size_t	t_count;
+};
+
+#define	GLOB_DIRCACHE_BUCKETS	64	/* initial number of buckets */
+
 struct glob_limit {
 	size_t	l_brace_cnt;
 	size_t	l_path_lim;
 	size_t	l_readdir_cnt;	
 	size_t	l_stat_cnt;	
 	size_t	l_string_cnt;
+	struct glob_dircache_tab l_dircache;
+};
+
+/*
+ * An entry of the results being sorted: `key` is the byte string the entry
+ * is ordered by, either the path itself (GLOB_BYTESORT), or its strxfrm(3)
+ * transform, computed once per entry rather than once per comparison.
+ */
+struct glob_sortent {
+	const unsigned char *s_key;
+	char	*s_path;
 };
 
+/* Partitions shorter than this are finished by insertion sort. */
+#define	GLOB_SORT_CUTOFF	12
+
 #define	DOT		L'.'
 #define	EOS		L'\0'
 #define	LBRACKET	L'['
@@ -150,6 +192,7 @@ typedef uint_fast64_t Char;
 #endif
 
 static int	 compare(const void *, const void *);
+static int	 compare_sortent(const void *, const void *);
 static int	 g_Ctoc(const Char *, char *, size_t);
 static int	 g_lstat(Char *, struct stat *, glob_t *);
 static DIR	*g_opendir(Char *, glob_t *);
@@ -165,6 +208,15 @@ static int	 glob2(Char *, Char *, Char *, Char *, glob_t *,
     struct glob_limit *);
 static int	 glob3(Char *, Char *, Char *, Char *, Char *, glob_t *,
     struct glob_limit *);
+static int	 glob3_cached(Char *, Char *, Char *, Char *, Char *, glob_t *,
+    struct glob_limit *, char *, struct glob_dircache *);
+static struct glob_dircache *
+		 g_dircache_get(Char *, const char *, glob_t *,
+    struct glob_limit *, int *, int *);
+static int	 g_dircache_add(struct glob_dircache_tab *,
+    struct glob_dircache *);
+static void	 g_dircache_free(struct glob_dircache_tab *);
+static int	 g_dname(Char *, Char *, const char *, Char **);
 static int	 globextend(const Char *, glob_t *, struct glob_limit *,
     const char *);
 static const Char *
@@ -176,6 +228,8 @@ static int	 globexp2(const Char *, const Char *, glob_t *,
     struct glob_limit *);
 static int	 globfinal(glob_t *, struct glob_limit *, size_t,
     const char *);
+static void	 globsort(char **, size_t, int);
+static void	 globsort_keys(struct glob_sortent *, size_t, size_t, int);
 static int	 match(Char *, Char *, Char *);
 static int	 err_nomatch(glob_t *, struct glob_limit *, const char *);
 static int	 err_aborted(glob_t *, int, char *);
@@ -187,13 +241,13 @@ int
 glob(const char * __restrict pattern, int flags,
 	 int (*errfunc)(const char *, int), glob_t * __restrict pglob)
 {
-	struct glob_limit limit = { 0, 0, 0, 0, 0 };
+	struct glob_limit limit = { 0, 0, 0, 0, 0, { NULL, 0, 0 } };
 	const char *patnext;
 	Char *bufnext, *bufend, patbuf[MAXPATHLEN], prot;
 	mbstate_t mbs;
 	wchar_t wc;
 	size_t clen;
-	int too_long;
+	int rv, too_long;
 
 	patnext = pattern;
 	if (!(flags & GLOB_APPEND)) {
@@ -255,9 +309,12 @@ glob(const char * __restrict pattern, int flags,
 	*bufnext = EOS;
 
 	if (flags & GLOB_BRACE)
-	    return (globexp0(patbuf, pglob, &limit, pattern));
+	    rv = globexp0(patbuf, pglob, &limit, pattern);
 	else
-	    return (glob0(patbuf, pglob, &limit, pattern));
+	    rv = glob0(patbuf, pglob, &limit, pattern);
+
+	g_dircache_free(&limit.l_dircache);
+	return (rv);
 }
 
 static int
@@ -613,18 +670,135 @@ globfinal(glob_t *pglob, struct glob_limit *limit, size_t oldpathc,
 		return (err_nomatch(pglob, limit, origpat));
 
 	if (!(pglob->gl_flags & GLOB_NOSORT))
-		qsort(pglob->gl_pathv + pglob->gl_offs + oldpathc,
-		    pglob->gl_pathc - oldpathc, sizeof(char *), compare);
+		globsort(pglob->gl_pathv + pglob->gl_offs + oldpathc,
+		    pglob->gl_pathc - oldpathc, pglob->gl_flags);
 
 	return (0);
 }
 
+/*
+ * Sorts the paths either in byte order (GLOB_BYTESORT), or in the collation
+ * order of the current locale. In the latter case strxfrm(3) keys are computed
+ * once per path, and then sorted in byte order, which yields the same order
+ * as strcoll(3) comparisons, without paying for the collation lookup in every
+ * comparison. If memory for the keys cannot be allocated, it falls back to
+ * plain qsort(3) with strcoll(3).
+ */
+static void
+globsort(char **pathv, size_t n, int flags)
+{
+	struct glob_sortent *ents;
+	unsigned char *keys, *k;
+	size_t i, len, total, depth_lim;
+
+	if (n < 2)
+		return;
+
+	ents = reallocarray(NULL, n, sizeof(*ents));
+	if (ents == NULL) {
+		qsort(pathv, n, sizeof(char *),
+		    (flags & GLOB_BYTESORT) ? compare_sortent : compare);
+		return;
+	}
+
+	keys = NULL;
+	if (flags & GLOB_BYTESORT) {
+		for (i = 0; i < n; i++)
+			ents[i].s_key = (const unsigned char *)pathv[i];
+	} else {
+		for (total = 0, i = 0; i < n; i++)
+			total += strxfrm(NULL, pathv[i], 0) + 1;
+		if ((keys = malloc(total)) == NULL) {
+			free(ents);
+			qsort(pathv, n, sizeof(char *), compare);
+			return;
+		}
+		for (k = keys, i = 0; i < n; i++) {
+			len = strxfrm((char *)k, pathv[i], total) + 1;
+			ents[i].s_key = k;
+			k += len;
+			total -= len;
+		}
+	}
+	for (i = 0; i < n; i++)
+		ents[i].s_path = pathv[i];
+
+	/* Past this many partitioning rounds fall back to qsort(3). */
+	for (depth_lim = 0, i = n; i > 0; i >>= 1)
+		depth_lim += 2;
+	globsort_keys(ents, n, 0, (int)depth_lim);
+
+	for (i = 0; i < n; i++)
+		pathv[i] = ents[i].s_path;
+	free(keys);
+	free(ents);
+}
+
+/*
+ * Multikey (three-way radix) quicksort of the entries by their keys, which
+ * are known to share the first `depth` bytes. Each round partitions entries
+ * by a single key byte, thus common prefixes are never compared twice.
+ */
+static void
+globsort_keys(struct glob_sortent *a, size_t n, size_t depth, int depth_lim)
+{
+	struct glob_sortent t;
+	size_t i, j, lt, gt;
+	unsigned char v;
+
+	while (n > GLOB_SORT_CUTOFF) {
+		v = a[n / 2].s_key[depth];
+		for (lt = 0, i = 0, gt = n; i < gt;) {
+			if (a[i].s_key[depth] < v) {
+				t = a[lt]; a[lt++] = a[i]; a[i++] = t;
+			} else if (a[i].s_key[depth] > v) {
+				t = a[--gt]; a[gt] = a[i]; a[i] = t;
+			} else
+				i++;
+		}
+		/*
+		 * Only real splits count against the budget; rounds over a byte
+		 * shared by all entries (e.g. of their common directory prefix)
+		 * just advance the depth.
+		 */
+		if ((lt > 0 || gt < n) && depth_lim-- <= 0) {
+			qsort(a, n, sizeof(*a), compare_sortent);
+			return;
+		}
+		globsort_keys(a, lt, depth, depth_lim);
+		globsort_keys(a + gt, n - gt, depth, depth_lim);
+		if (v == '\0')
+			return;
+		a += lt;
+		n = gt - lt;
+		depth++;
+	}
+
+	for (i = 1; i < n; i++) {
+		t = a[i];
+		for (j = i; j > 0 && strcmp((const char *)a[j - 1].s_key + depth,
+		    (const char *)t.s_key + depth) > 0; j--)
+			a[j] = a[j - 1];
+		a[j] = t;
+	}
+}
+
 static int
 compare(const void *p, const void *q)
 {
 	return (strcoll(*(char **)p, *(char **)q));
 }
 
+/*
+ * Byte order comparison; it works both for glob_sortent records, and for
+ * plain (char *) path arrays, as the key is the leading pointer in both.
+ */
+static int
+compare_sortent(const void *p, const void *q)
+{
+	return (strcmp(*(char **)p, *(char **)q));
+}
+
 static int
 glob1(Char *pattern, glob_t *pglob, struct glob_limit *limit)
 {
@@ -718,8 +892,9 @@ glob3(Char *pathbuf, Char *pathend, Char *pathend_last,
       glob_t *pglob, struct glob_limit *limit)
 {
 	struct dirent *dp;
+	struct glob_dircache *ent;
 	DIR *dirp;
-	int err, too_long, saverrno, saverrno2;
+	int err, partial, too_long, saverrno, saverrno2;
 	char buf[MAXPATHLEN + MB_LEN_MAX - 1];
 
 	struct dirent *(*readdirfunc)(DIR *);
@@ -729,13 +904,30 @@ glob3(Char *pathbuf, Char *pathend, Char *pathend_last,
 		return (GLOB_NOSPACE);
 	}
 	*pathend = EOS;
-	if (pglob->gl_errfunc != NULL &&
+	if ((pglob->gl_errfunc != NULL ||
+	    (pglob->gl_flags & GLOB_DIRCACHE)) &&
 	    g_Ctoc(pathbuf, buf, sizeof(buf))) {
 		errno = E2BIG;
 		return (GLOB_NOSPACE);
 	}
 
 	saverrno = errno;
+	if (pglob->gl_flags & GLOB_DIRCACHE) {
+		err = partial = 0;
+		ent = g_dircache_get(pathbuf, buf, pglob, limit, &err,
+		    &partial);
+		if (ent != NULL)
+			return (glob3_cached(pathbuf, pathend, pathend_last,
+			    pattern, restpattern, pglob, limit, buf, ent));
+		if (!partial)
+			return (err);
+		/*
+		 * The directory could not be read completely, thus it is not
+		 * cached; read it again without the cache, to match the
+		 * entries read before the failure, as without GLOB_DIRCACHE.
+		 */
+	}
+
 	errno = 0;
 	if ((dirp = g_opendir(pathbuf, pglob)) == NULL) {
 		if (errno == ENOENT || errno == ENOTDIR)
@@ -757,11 +949,7 @@ glob3(Char *pathbuf, Char *pathend, Char *pathend_last,
 	errno = 0;
 	/* Search directory for matching names. */
 	while ((dp = (*readdirfunc)(dirp)) != NULL) {
-		char *sc;
 		Char *dc;
-		wchar_t wc;
-		size_t clen;
-		mbstate_t mbs;
 
 		if ((pglob->gl_flags & GLOB_LIMIT) &&
 		    limit->l_readdir_cnt++ >= GLOB_LIMIT_READDIR) {
@@ -775,24 +963,7 @@ glob3(Char *pathbuf, Char *pathend, Char *pathend_last,
 			errno = 0;
 			continue;
 		}
-		memset(&mbs, 0, sizeof(mbs));
-		dc = pathend;
-		sc = dp->d_name;
-		too_long = 1;
-		while (dc <= pathend_last) {
-			clen = mbrtowc(&wc, sc, MB_LEN_MAX, &mbs);
-			if (clen == (size_t)-1 || clen == (size_t)-2) {
-				/* XXX See initial comment #2. */
-				wc = (unsigned char)*sc;
-				clen = 1;
-				memset(&mbs, 0, sizeof(mbs));
-			}
-			if ((*dc++ = wc) == EOS) {
-				too_long = 0;
-				break;
-			}
-			sc += clen;
-		}
+		too_long = g_dname(pathend, pathend_last, dp->d_name, &dc);
 		if (too_long && (err = err_aborted(pglob, ENAMETOOLONG,
 		    buf))) {
 			errno = ENAMETOOLONG;
@@ -805,7 +976,7 @@ glob3(Char *pathbuf, Char *pathend, Char *pathend_last,
 		}
 		if (errno == 0)
 			errno = saverrno;
-		err = glob2(pathbuf, --dc, pathend_last, restpattern,
+		err = glob2(pathbuf, dc, pathend_last, restpattern,
 		    pglob, limit);
 		if (err)
 			break;
@@ -831,6 +1002,206 @@ glob3(Char *pathbuf, Char *pathend, Char *pathend_last,
 	return (0);
 }
 
+/*
+ * The GLOB_DIRCACHE counterpart of glob3(): it matches the pattern segment
+ * against the cached entries `ent` of the directory. `key` is the directory
+ * path, already converted by g_Ctoc().
+ */
+static int
+glob3_cached(Char *pathbuf, Char *pathend, Char *pathend_last,
+      Char *pattern, Char *restpattern,
+      glob_t *pglob, struct glob_limit *limit, char *key,
+      struct glob_dircache *ent)
+{
+	const char *name, *end;
+	Char *dc;
+	int err, too_long, saverrno;
+
+	saverrno = errno;
+	for (name = ent->c_names, end = name + ent->c_len; name < end;
+	    name += strlen(name) + 1) {
+		/* Initial DOT must be matched literally. */
+		if (name[0] == '.' && UNPROT(*pattern) != DOT)
+			continue;
+		too_long = g_dname(pathend, pathend_last, name, &dc);
+		if (too_long && (err = err_aborted(pglob, ENAMETOOLONG,
+		    key))) {
+			errno = ENAMETOOLONG;
+			return (err);
+		}
+		if (too_long || !match(pathend, pattern, restpattern)) {
+			*pathend = EOS;
+			continue;
+		}
+		errno = saverrno;
+		if ((err = glob2(pathbuf, dc, pathend_last, restpattern,
+		    pglob, limit)) != 0)
+			return (err);
+	}
+
+	errno = saverrno;
+	return (0);
+}
+
+/*
+ * Returns the cached entries of the directory `pathbuf`, reading them if
+ * the directory is not in the cache yet. On failure it returns NULL, and
+ * sets `*err` to the glob() error code, if the error should abort globbing.
+ * If the directory was opened, but could not be read completely, it instead
+ * sets `*partial`, leaving the read counter as it was, for the caller to
+ * read the directory without the cache.
+ */
+static struct glob_dircache *
+g_dircache_get(Char *pathbuf, const char *key, glob_t *pglob,
+    struct glob_limit *limit, int *err, int *partial)
+{
+	struct glob_dircache_tab *tab = &limit->l_dircache;
+	struct glob_dircache *ent;
+	struct dirent *dp;
+	DIR *dirp;
+	const unsigned char *k;
+	char *names;
+	size_t cap, len, hash, readdir_cnt;
+	int saverrno;
+
+	struct dirent *(*readdirfunc)(DIR *);
+
+	/* FNV-1a hash of the path. */
+	for (hash = 2166136261u, k = (const unsigned char *)key; *k; k++)
+		hash = (hash ^ *k) * 16777619u;
+
+	if (tab->t_size != 0)
+		for (ent = tab->t_buckets[hash & (tab->t_size - 1)];
+		    ent != NULL; ent = ent->c_next)
+			if (ent->c_hash == hash && strcmp(ent->c_path, key) == 0)
+				return (ent);
+
+	len = strlen(key) + 1;
+	if ((ent = malloc(sizeof(*ent) + len)) == NULL) {
+		*err = GLOB_NOSPACE;
+		return (NULL);
+	}
+	memcpy(ent->c_path, key, len);
+	ent->c_hash = hash;
+	ent->c_names = NULL;
+	ent->c_len = 0;
+
+	errno = 0;
+	if ((dirp = g_opendir(pathbuf, pglob)) == NULL) {
+		if (errno == ENOENT || errno == ENOTDIR) {
+			if (g_dircache_add(tab, ent) == 0)
+				return (ent);
+			free(ent);
+			*err = GLOB_NOSPACE;
+			return (NULL);
+		}
+		saverrno = errno;
+		free(ent);
+		*err = err_aborted(pglob, saverrno, (char *)key);
+		return (NULL);
+	}
+
+	/* pglob->gl_readdir takes a void *, fix this manually */
+	if (pglob->gl_flags & GLOB_ALTDIRFUNC)
+		readdirfunc = (struct dirent *(*)(DIR *))pglob->gl_readdir;
+	else
+		readdirfunc = readdir;
+
+	cap = 0;
+	readdir_cnt = limit->l_readdir_cnt;
+	errno = 0;
+	while ((dp = (*readdirfunc)(dirp)) != NULL) {
+		if ((pglob->gl_flags & GLOB_LIMIT) &&
+		    limit->l_readdir_cnt++ >= GLOB_LIMIT_READDIR) {
+			*partial = 1;
+			break;
+		}
+		len = strlen(dp->d_name) + 1;
+		if (ent->c_len + len > cap) {
+			cap = 2 * (ent->c_len + len);
+			if ((names = realloc(ent->c_names, cap)) == NULL) {
+				*partial = 1;
+				break;
+			}
+			ent->c_names = names;
+		}
+		memcpy(ent->c_names + ent->c_len, dp->d_name, len);
+		ent->c_len += len;
+		errno = 0;
+	}
+
+	if (dp == NULL && errno != 0)
+		*partial = 1;
+	if (pglob->gl_flags & GLOB_ALTDIRFUNC)
+		(*pglob->gl_closedir)(dirp);
+	else
+		closedir(dirp);
+
+	/* A partially read directory is not cached. */
+	if (*partial) {
+		limit->l_readdir_cnt = readdir_cnt;
+		free(ent->c_names);
+		free(ent);
+		return (NULL);
+	}
+
+	if (g_dircache_add(tab, ent) == 0)
+		return (ent);
+	free(ent->c_names);
+	free(ent);
+	*err = GLOB_NOSPACE;
+	return (NULL);
+}
+
+/*
+ * Inserts the entry into the table, growing the table as needed. If memory
+ * for more buckets cannot be allocated the table keeps its current size; it
+ * returns -1 only if there is no table at all.
+ */
+static int
+g_dircache_add(struct glob_dircache_tab *tab, struct glob_dircache *ent)
+{
+	struct glob_dircache **buckets, *e, *next;
+	size_t i, size;
+
+	if (tab->t_count >= 2 * tab->t_size) {
+		size = tab->t_size ? 2 * tab->t_size : GLOB_DIRCACHE_BUCKETS;
+		buckets = calloc(size, sizeof(*buckets));
+		if (buckets != NULL) {
+			for (i = 0; i < tab->t_size; i++)
+				for (e = tab->t_buckets[i]; e != NULL; e = next) {
+					next = e->c_next;
+					e->c_next = buckets[e->c_hash & (size - 1)];
+					buckets[e->c_hash & (size - 1)] = e;
+				}
+			free(tab->t_buckets);
+			tab->t_buckets = buckets;
+			tab->t_size = size;
+		} else if (tab->t_size == 0)
+			return (-1);
+	}
+	i = ent->c_hash & (tab->t_size - 1);
+	ent->c_next = tab->t_buckets[i];
+	tab->t_buckets[i] = ent;
+	tab->t_count++;
+	return (0);
+}
+
+static void
+g_dircache_free(struct glob_dircache_tab *tab)
+{
+	struct glob_dircache *ent, *next;
+	size_t i;
+
+	for (i = 0; i < tab->t_size; i++)
+		for (ent = tab->t_buckets[i]; ent != NULL; ent = next) {
+			next = ent->c_next;
+			free(ent->c_names);
+			free(ent);
+		}
+	free(tab->t_buckets);
+}
+
 
 /*
  * Extend the gl_pathv member of a glob_t structure to accommodate a new item,
@@ -911,7 +1282,7 @@ match(Char *name, Char *pat, Char *patend)
 {
 	int ok, negate_range;
 	Char c, k, *nextp, *nextn;
-#if !defined(__BIONIC__)
+#if defined(__FreeBSD__)
 	struct xlocale_collate *table =
 		(struct xlocale_collate*)__get_locale()->components[XLC_COLLATE];
 #endif
@@ -944,7 +1315,7 @@ match(Char *name, Char *pat, Char *patend)
 					++pat;
 				while (((c = *pat++) & M_MASK) != M_END)
 					if ((*pat & M_MASK) == M_RNG) {
-#if defined(__BIONIC__)
+#if !defined(__FreeBSD__)
 						if (c <= k && k <= pat[1])
 #else
 						if (table->__collate_load_error ?
@@ -1045,6 +1416,37 @@ g_stat(Char *fn, struct stat *sb, glob_t *pglob)
 	return (stat(buf, sb));
 }
 
+/*
+ * Converts directory entry name `sc` into Char string at `dc`, not writing
+ * past `dc_last`. On success it returns 0, and points `*end` to the final EOS;
+ * it returns 1 if the name does not fit.
+ */
+static int
+g_dname(Char *dc, Char *dc_last, const char *sc, Char **end)
+{
+	mbstate_t mbs;
+	wchar_t wc;
+	size_t clen;
+
+	memset(&mbs, 0, sizeof(mbs));
+	while (dc <= dc_last) {
+		clen = mbrtowc(&wc, sc, MB_LEN_MAX, &mbs);
+		if (clen == (size_t)-1 || clen == (size_t)-2) {
+			/* XXX See initial comment #2. */
+			wc = (unsigned char)*sc;
+			clen = 1;
+			memset(&mbs, 0, sizeof(mbs));
+		}
+		if ((*dc++ = wc) == EOS) {
+			*end = dc - 1;
+			return (0);
+		}
+		sc += clen;
+	}
+	*end = dc;
+	return (1);
+}
+
 static const Char *
 g_strchr(const Char *str, wchar_t ch)
 {
@@ -88,6 +88,8 @@ typedef struct {
 #define GLOB_QUOTE	0x0400	/* Quote special chars with \. */
 #define GLOB_TILDE	0x0800	/* Expand tilde names from the passwd file. */
 #define GLOB_LIMIT	0x1000	/* limit number of returned paths */
+#define GLOB_BYTESORT	0x4000	/* Sort in byte order, ignoring the locale. */
+#define GLOB_DIRCACHE	0x8000	/* Read each directory once per glob() call. */
 #endif
 
 __BEGIN_DECLS
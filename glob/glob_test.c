@@ -0,0 +1,239 @@
+/*
+ * Checks that GLOB_DIRCACHE does not change glob(3) results: it populates
+ * a scratch directory, and compares the return codes and the paths matched
+ * by glob() with and without the flag, including a directory whose reading
+ * fails halfway (simulated with GLOB_ALTDIRFUNC), which must still yield
+ * the entries read before the failure.
+ *
+ * It also checks the sorting of results: a folder with many entries sharing
+ * long prefixes (thus, sorted by multikey partitioning rounds, rather than
+ * by insertion sort alone) must be globbed in strcoll(3) order by default,
+ * under the C and the environment locales, and in strcmp(3) order with
+ * GLOB_BYTESORT.
+ *
+ * Usage: glob_test
+ */
+
+#include <sys/stat.h>
+
+#include <dirent.h>
+#include <errno.h>
+#include <glob.h>
+#include <limits.h>
+#include <locale.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* Entries read from the "bad" folder before its reading fails. */
+#define	BAD_READS	4
+
+/* Entries of the "sort" folder, and the prefixes of their names. */
+#define	SORT_FILES	600
+static const char *const sort_prefixes[] = {
+	"img-", "Img-", "img_", "icon-", "i", "IMG-", "a", "B", "b-", "_x",
+};
+#define	SORT_PREFIXES	(sizeof(sort_prefixes) / sizeof(sort_prefixes[0]))
+
+struct test_dir {
+	DIR	*d_dir;
+	int	 d_bad;
+	int	 d_reads;
+};
+
+static const char *const files[] = {
+	"a/1.txt", "a/2.png", "a/3.js", "a/.hidden.txt",
+	"b/1.txt", "b/2.png", "b/c/3.txt",
+	"bad/1.txt", "bad/2.png", "bad/3.txt", "bad/4.png", "bad/5.txt",
+	"bad/6.png", "bad/7.txt", "bad/8.png",
+	NULL
+};
+
+/* Folders to remove after the test, the nested ones first. */
+static const char *const dirs[] = { "b/c", "a", "b", "bad", NULL };
+
+static const char *const patterns[] = {
+	"*/*",
+	"{a,b}/*.{txt,png}",
+	"{a,b,bad}/*.{txt,png,js}",
+	"{bad,a}/*.txt",
+	"{a,a/.,b/c}/*",
+	"{missing,a}/*",
+	"{a,b}/{*.txt,c/*}",
+	"{b,b/c,bad}/*.txt",
+	NULL
+};
+
+static void *
+test_opendir(const char *path)
+{
+	struct test_dir *d;
+	size_t len;
+
+	if ((d = calloc(1, sizeof(*d))) == NULL)
+		return (NULL);
+	if ((d->d_dir = opendir(path)) == NULL) {
+		free(d);
+		return (NULL);
+	}
+	/* glob() passes folder paths with the trailing slash. */
+	len = strlen(path);
+	d->d_bad = len >= 4 && strcmp(path + len - 4, "bad/") == 0;
+	return (d);
+}
+
+static struct dirent *
+test_readdir(void *p)
+{
+	struct test_dir *d = p;
+
+	if (d->d_bad && d->d_reads++ >= BAD_READS) {
+		errno = EIO;
+		return (NULL);
+	}
+	return (readdir(d->d_dir));
+}
+
+static void
+test_closedir(void *p)
+{
+	struct test_dir *d = p;
+
+	closedir(d->d_dir);
+	free(d);
+}
+
+static int
+run(const char *dir, const char *pattern, int flags, glob_t *g)
+{
+	char path[PATH_MAX];
+
+	snprintf(path, sizeof(path), "%s/%s", dir, pattern);
+	memset(g, 0, sizeof(*g));
+	g->gl_opendir = test_opendir;
+	g->gl_readdir = test_readdir;
+	g->gl_closedir = test_closedir;
+	g->gl_lstat = lstat;
+	g->gl_stat = stat;
+	return (glob(path, flags | GLOB_ALTDIRFUNC | GLOB_BRACE, NULL, g));
+}
+
+static int
+check(const char *dir, const char *pattern, int flags)
+{
+	glob_t plain, cached;
+	int failed, rc1, rc2;
+	size_t i;
+
+	rc1 = run(dir, pattern, flags, &plain);
+	rc2 = run(dir, pattern, flags | GLOB_DIRCACHE, &cached);
+	failed = rc1 != rc2 || plain.gl_pathc != cached.gl_pathc;
+	for (i = 0; !failed && i < plain.gl_pathc; i++)
+		failed = strcmp(plain.gl_pathv[i], cached.gl_pathv[i]) != 0;
+	printf("%s %-28s flags %#06x: %d (%zu paths) vs %d (%zu paths)\n",
+	    failed ? "FAIL" : "ok  ", pattern, flags, rc1, plain.gl_pathc,
+	    rc2, cached.gl_pathc);
+	globfree(&plain);
+	globfree(&cached);
+	return (failed);
+}
+
+static void
+sort_file_path(char *path, size_t size, const char *dir, int i)
+{
+	snprintf(path, size, "%s/sort/%s%d.%s", dir,
+	    sort_prefixes[i % SORT_PREFIXES], i / 7, i % 3 ? "png" : "js");
+}
+
+static int
+check_sort(const char *dir, int flags, const char *locale)
+{
+	char pattern[PATH_MAX];
+	size_t i;
+	glob_t g;
+	int failed, rc;
+
+	snprintf(pattern, sizeof(pattern), "%s/sort/*", dir);
+	rc = glob(pattern, flags, NULL, &g);
+	failed = rc != 0 || g.gl_pathc != SORT_FILES;
+	for (i = 1; !failed && i < g.gl_pathc; i++) {
+		failed = (flags & GLOB_BYTESORT ?
+		    strcmp(g.gl_pathv[i - 1], g.gl_pathv[i]) :
+		    strcoll(g.gl_pathv[i - 1], g.gl_pathv[i])) > 0;
+	}
+	printf("%s sort, locale %-14s flags %#06x: %d (%zu paths)\n",
+	    failed ? "FAIL" : "ok  ", locale, flags, rc,
+	    rc == 0 ? g.gl_pathc : 0);
+	if (rc == 0)
+		globfree(&g);
+	return (failed);
+}
+
+int
+main(void)
+{
+	char dir[] = "/tmp/glob_test.XXXXXX";
+	char path[PATH_MAX];
+	const char *const *p;
+	const char *locale;
+	int failed, i;
+	char *slash;
+	FILE *f;
+
+	if (mkdtemp(dir) == NULL) {
+		perror("mkdtemp");
+		return (1);
+	}
+	for (p = files; *p != NULL; p++) {
+		snprintf(path, sizeof(path), "%s/%s", dir, *p);
+		for (slash = path + strlen(dir) + 1;
+		    (slash = strchr(slash, '/')) != NULL; slash++) {
+			*slash = '\0';
+			mkdir(path, 0700);
+			*slash = '/';
+		}
+		if ((f = fopen(path, "w")) != NULL)
+			fclose(f);
+	}
+
+	snprintf(path, sizeof(path), "%s/sort", dir);
+	mkdir(path, 0700);
+	for (i = 0; i < SORT_FILES; i++) {
+		sort_file_path(path, sizeof(path), dir, i);
+		if ((f = fopen(path, "w")) != NULL)
+			fclose(f);
+	}
+
+	failed = 0;
+	for (p = patterns; *p != NULL; p++) {
+		failed |= check(dir, *p, 0);
+		failed |= check(dir, *p, GLOB_ERR);
+		failed |= check(dir, *p, GLOB_MARK | GLOB_NOSORT);
+	}
+
+	failed |= check_sort(dir, 0, "C");
+	failed |= check_sort(dir, GLOB_BYTESORT, "C");
+	if ((locale = setlocale(LC_ALL, "")) != NULL) {
+		failed |= check_sort(dir, 0, locale);
+		failed |= check_sort(dir, GLOB_BYTESORT, locale);
+	}
+
+	for (i = 0; i < SORT_FILES; i++) {
+		sort_file_path(path, sizeof(path), dir, i);
+		unlink(path);
+	}
+	snprintf(path, sizeof(path), "%s/sort", dir);
+	rmdir(path);
+
+	for (p = files; *p != NULL; p++) {
+		snprintf(path, sizeof(path), "%s/%s", dir, *p);
+		unlink(path);
+	}
+	for (p = dirs; *p != NULL; p++) {
+		snprintf(path, sizeof(path), "%s/%s", dir, *p);
+		rmdir(path);
+	}
+	rmdir(dir);
+	return (failed);
+}
@@ -0,0 +1,23 @@
+/*
+ * Definitions bionic provides, for builds of the library against other
+ * C libraries, i.e. glibc of Linux hosts, where its tests and benchmark run.
+ * CMakeLists.txt force-includes it into non-Android builds only.
+ */
+
+#pragma once
+
+#include <sys/cdefs.h>
+
+#ifndef __FBSDID
+#define __FBSDID(s)
+#endif
+
+#ifndef __clang__
+#define _Nonnull
+#define _Nullable
+#endif
+
+/* The same as bionic's one. */
+#ifndef ARG_MAX
+#define ARG_MAX 131072
+#endif
@@ -0,0 +1,30 @@
+#!/bin/bash
+set -e
+
+# Collects the PGO profile of the server under the benchmark load
+# (see bench/README.md), for RNSS_PGO=USE builds of the library:
+# - Builds the instrumented rnss_host (RNSS_PGO=GENERATE), with Clang;
+# - Runs the benchmark suite against it (extra arguments of this script are
+#   passed to bench/run.mjs);
+# - Merges the collected raw profiles into pgo/rnss.profdata.
+# It requires clang, and llvm-profdata of the same LLVM version, in the PATH.
+
+SCRIPT_FOLDER=$(dirname $(realpath $0))
+ROOT_FOLDER=$(dirname $SCRIPT_FOLDER)
+BUILD_FOLDER="$ROOT_FOLDER/build-pgo"
+OUTPUT_FOLDER="$ROOT_FOLDER/pgo"
+
+CC=${CC:-clang} cmake -S $ROOT_FOLDER -B $BUILD_FOLDER -DCMAKE_BUILD_TYPE=Release \
+  -DBUILD_STATIC=ON -DBUILD_LIBRARY=ON -DWITH_RNSS_HOST=ON -DWITH_MOD_WEBDAV=ON \
+  -DRNSS_PGO=GENERATE
+cmake --build $BUILD_FOLDER --target rnss_host
+
+# NOTE: The raw profiles are written by the server process on its exit,
+# thus the benchmark must terminate it gracefully (it does).
+rm -rf $BUILD_FOLDER/pgo
+node $ROOT_FOLDER/bench/run.mjs --server $BUILD_FOLDER/host/rnss_host \
+  --out $BUILD_FOLDER/bench-results.json "$@"
+
+mkdir -p $OUTPUT_FOLDER
+llvm-profdata merge -o $OUTPUT_FOLDER/rnss.profdata $BUILD_FOLDER/pgo/*.profraw
+echo "PGO profile written to $OUTPUT_FOLDER/rnss.profdata"
@@ -0,0 +1,167 @@
+// Decoder of binary access log files exported by the library
+// (StaticServer.exportAccessLog(), see the accessLog option in README.md).
+//
+// File format (little-endian):
+//   Header, 32 bytes:
+//     char[8]  magic "RNSSAL01";
+//     uint32   record size (20);
+//     uint32   record count;
+//     uint64   count of requests seen by the log (sampled or not);
+//     uint64   count of sampled records overwritten in the ring.
+//   Records, oldest first:
+//     uint32   Unix time (s) of the request;
+//     uint32   request handling time (us);
+//     uint32   response body size (bytes);
+//     uint32   FNV-1a hash of the URL path;
+//     uint16   HTTP status;
+//     uint8    cache outcome (0 - none, 1 - revalidated, i.e. 304);
+//     uint8    reserved.
+//
+// It prints the records as CSV. Path hashes are printed in hex, or, given
+// a file with the list of known URL paths (one per line, -p option), they
+// are resolved into the paths where possible.
+
+#define _GNU_SOURCE
+
+#include <getopt.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAGIC "RNSSAL01"
+#define HEADER_SIZE 32
+#define RECORD_SIZE 20
+
+struct known_path {
+  uint32_t hash;
+  char *path;
+};
+
+static struct known_path *paths;
+static size_t num_paths;
+
+static uint32_t fnv1a(const char *s, size_t size) {
+  uint32_t hash = 2166136261u;
+  for (size_t i = 0; i < size; ++i) {
+    hash ^= (uint8_t)s[i];
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+static uint16_t u16(const unsigned char *p) {
+  return p[0] | p[1] << 8;
+}
+
+static uint32_t u32(const unsigned char *p) {
+  return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static uint64_t u64(const unsigned char *p) {
+  return u32(p) | (uint64_t)u32(p + 4) << 32;
+}
+
+static int load_paths(const char *file) {
+  FILE *f = fopen(file, "r");
+  if (!f) return -1;
+
+  char *line = NULL;
+  size_t cap = 0, size = 0;
+  ssize_t len;
+  while ((len = getline(&line, &cap, f)) >= 0) {
+    while (len && (line[len - 1] == '\n' || line[len - 1] == '\r')) --len;
+    if (!len) continue;
+    if (num_paths == size) {
+      size = size ? 2 * size : 256;
+      paths = realloc(paths, size * sizeof(*paths));
+    }
+    paths[num_paths].hash = fnv1a(line, len);
+    paths[num_paths++].path = strndup(line, len);
+  }
+  free(line);
+  fclose(f);
+  return 0;
+}
+
+static const char *find_path(uint32_t hash) {
+  for (size_t i = 0; i < num_paths; ++i) {
+    if (paths[i].hash == hash) return paths[i].path;
+  }
+  return NULL;
+}
+
+static void usage(const char *name) {
+  fprintf(stderr,
+    "Usage: %s [options] FILE\n"
+    "  -p, --paths FILE  Resolve path hashes using known URL paths\n"
+    "                    listed in FILE, one per line\n"
+    "  -h, --help        Print this help\n",
+    name);
+}
+
+int main(int argc, char **argv) {
+  static const struct option options[] = {
+    {"paths", required_argument, NULL, 'p'},
+    {"help", no_argument, NULL, 'h'},
+    {NULL, 0, NULL, 0},
+  };
+
+  int opt;
+  while ((opt = getopt_long(argc, argv, "p:h", options, NULL)) != -1) {
+    switch (opt) {
+      case 'p':
+        if (load_paths(optarg)) {
+          perror(optarg);
+          return 1;
+        }
+        break;
+      case 'h':
+        usage(argv[0]);
+        return 0;
+      default:
+        usage(argv[0]);
+        return 1;
+    }
+  }
+  if (optind != argc - 1) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  const char *file = argv[optind];
+  FILE *f = fopen(file, "rb");
+  if (!f) {
+    perror(file);
+    return 1;
+  }
+
+  unsigned char header[HEADER_SIZE];
+  if (fread(header, HEADER_SIZE, 1, f) != 1
+    || memcmp(header, MAGIC, 8) || u32(header + 8) != RECORD_SIZE) {
+    fprintf(stderr, "%s: not an access log file\n", file);
+    return 1;
+  }
+  uint32_t count = u32(header + 12);
+
+  fprintf(stderr, "%u records, %llu requests seen, %llu records overwritten\n",
+    count, (unsigned long long)u64(header + 16),
+    (unsigned long long)u64(header + 24));
+
+  printf("time,duration_us,status,bytes,cache,path\n");
+  unsigned char r[RECORD_SIZE];
+  for (uint32_t i = 0; i < count; ++i) {
+    if (fread(r, RECORD_SIZE, 1, f) != 1) {
+      fprintf(stderr, "%s: truncated after %u records\n", file, i);
+      return 1;
+    }
+    printf("%u,%u,%u,%u,%s,", u32(r), u32(r + 4), u16(r + 16), u32(r + 8),
+      r[18] ? "revalidated" : "none");
+    const char *path = find_path(u32(r + 12));
+    if (path) printf("\"%s\"\n", path);
+    else printf("#%08x\n", u32(r + 12));
+  }
+
+  fclose(f);
+  return 0;
+}
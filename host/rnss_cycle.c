@@ -0,0 +1,333 @@
+// Cold-start and restart latency benchmark of the server launch lifecycle:
+// it runs in a single process many cycles of
+//   config write -> lighttpd_launch() -> LAUNCHED callback -> first response
+//   byte -> lighttpd_graceful_shutdown() -> lighttpd_launch() return,
+// the same way the library (re-)starts the server within apps, and reports
+// the duration of each phase, along with the process RSS and open file
+// descriptor counts across the cycles, to reveal leaks.
+//
+// The launch phase is split at the moment the server binds its listening
+// socket: the time before it covers config reading & parsing, and plugin
+// initialization; the time after it covers the rest of the start-up, till
+// the server enters its event loop and reports LAUNCHED.
+
+#define _GNU_SOURCE
+
+#include <arpa/inet.h>
+#include <dirent.h>
+#include <dlfcn.h>
+#include <getopt.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "standard_config.h"
+
+int lighttpd_launch(
+  const char *config_path,
+  const char *module_path,
+  const char *errlog_path,
+  void (*cb)()
+);
+
+void lighttpd_graceful_shutdown();
+
+enum {
+  PHASE_CONFIG_WRITE,
+  PHASE_PRE_BIND,
+  PHASE_POST_BIND,
+  PHASE_FIRST_BYTE,
+  PHASE_SHUTDOWN,
+  PHASE_TOTAL,
+  NUM_PHASES
+};
+
+static const char *PHASE_NAMES[NUM_PHASES] = {
+  "config-write",
+  "launch-to-bind",
+  "bind-to-launched",
+  "first-byte",
+  "shutdown",
+  "total",
+};
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t cond = PTHREAD_COND_INITIALIZER;
+static int launched;
+static double bind_ms;
+
+static double now_ms() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+// Interposes bind() of the C library, to timestamp the moment the server
+// binds its listening socket (only the first bind of a cycle is recorded).
+int bind(int fd, const struct sockaddr *addr, socklen_t len) {
+  static int (*real_bind)(int, const struct sockaddr *, socklen_t);
+  if (!real_bind) real_bind = dlsym(RTLD_NEXT, "bind");
+  int res = real_bind(fd, addr, len);
+  pthread_mutex_lock(&lock);
+  if (bind_ms == 0) bind_ms = now_ms();
+  pthread_mutex_unlock(&lock);
+  return res;
+}
+
+static void on_launched() {
+  pthread_mutex_lock(&lock);
+  launched = 1;
+  pthread_cond_signal(&cond);
+  pthread_mutex_unlock(&lock);
+}
+
+struct launch_args {
+  const char *config_path;
+  const char *errlog_path;
+  int res;
+};
+
+static void *server_thread(void *arg) {
+  struct launch_args *args = arg;
+  args->res = lighttpd_launch(args->config_path, NULL, args->errlog_path,
+    on_launched);
+
+  // Wakes up the main thread if the server failed before LAUNCHED.
+  pthread_mutex_lock(&lock);
+  launched = -1;
+  pthread_cond_signal(&cond);
+  pthread_mutex_unlock(&lock);
+  return NULL;
+}
+
+// Sends a GET request, and returns once the first response byte arrives.
+static int first_byte(const char *host, int port) {
+  struct sockaddr_in addr = {.sin_family = AF_INET, .sin_port = htons(port)};
+  char buf[4096];
+  int fd, res = -1;
+
+  if (inet_pton(AF_INET, host, &addr.sin_addr) != 1) return -1;
+  fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (fd < 0) return -1;
+  if (!connect(fd, (struct sockaddr *)&addr, sizeof(addr))) {
+    int n = snprintf(buf, sizeof(buf),
+      "GET / HTTP/1.1\r\nHost: %s\r\nConnection: close\r\n\r\n", host);
+    if (write(fd, buf, n) == n && read(fd, buf, 1) == 1) {
+      res = 0;
+      while (read(fd, buf, sizeof(buf)) > 0);
+    }
+  }
+  close(fd);
+  return res;
+}
+
+static long rss_kb() {
+  long pages = 0, rss = 0;
+  FILE *f = fopen("/proc/self/statm", "r");
+  if (!f) return -1;
+  if (fscanf(f, "%ld %ld", &pages, &rss) != 2) rss = -1;
+  fclose(f);
+  return rss < 0 ? -1 : rss * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+static int num_fds() {
+  int n = 0;
+  DIR *dir = opendir("/proc/self/fd");
+  if (!dir) return -1;
+  while (readdir(dir)) ++n;
+  closedir(dir);
+  return n - 3; // ".", "..", and the fd of opened dir itself.
+}
+
+static int compare_doubles(const void *a, const void *b) {
+  double x = *(const double *)a, y = *(const double *)b;
+  return x < y ? -1 : x > y;
+}
+
+static void usage(const char *name) {
+  fprintf(stderr,
+    "Usage: %s [options] <fileDir>\n"
+    "  -n, --cycles <n>           Number of launch cycles (default: 1000).\n"
+    "  -h, --hostname <address>   Address to bind to (default: 127.0.0.1).\n"
+    "  -p, --port <port>          Port to listen at (default: 8080).\n"
+    "  -w, --work-dir <dir>       Working directory for configs, logs,\n"
+    "                             and uploads (default: /tmp/__rn-static-server__).\n"
+    "  -x, --extra-config <file>  Append the content of the file to the config.\n"
+    "  -c, --csv <file>           Write per-cycle measurements into CSV file.\n"
+    "  -f, --max-fd-growth <n>    Fail if open fd count grows more than this\n"
+    "                             across the cycles (default: 0).\n"
+    "  -r, --max-rss-growth <kb>  Fail if RSS grows more than this after\n"
+    "                             the first cycle (default: 2048).\n",
+    name);
+}
+
+int main(int argc, char **argv) {
+  static const struct option options[] = {
+    {"csv", required_argument, NULL, 'c'},
+    {"cycles", required_argument, NULL, 'n'},
+    {"extra-config", required_argument, NULL, 'x'},
+    {"help", no_argument, NULL, '?'},
+    {"hostname", required_argument, NULL, 'h'},
+    {"max-fd-growth", required_argument, NULL, 'f'},
+    {"max-rss-growth", required_argument, NULL, 'r'},
+    {"port", required_argument, NULL, 'p'},
+    {"work-dir", required_argument, NULL, 'w'},
+    {NULL, 0, NULL, 0},
+  };
+
+  struct rnss_config config = {
+    .hostname = "127.0.0.1",
+    .port = 8080,
+    .work_dir = "/tmp/__rn-static-server__",
+  };
+  const char *csv_path = NULL;
+  long max_rss_growth = 2048;
+  int cycles = 1000, max_fd_growth = 0, opt;
+
+  while ((opt = getopt_long(argc, argv, "c:f:h:n:p:r:w:x:", options, NULL)) != -1) {
+    switch (opt) {
+      case 'c': csv_path = optarg; break;
+      case 'f': max_fd_growth = atoi(optarg); break;
+      case 'h': config.hostname = optarg; break;
+      case 'n': cycles = atoi(optarg); break;
+      case 'p': config.port = atoi(optarg); break;
+      case 'r': max_rss_growth = atol(optarg); break;
+      case 'w': config.work_dir = optarg; break;
+      case 'x':
+        config.extra_config = rnss_read_extra_config(optarg);
+        if (!config.extra_config) {
+          perror(optarg);
+          return 2;
+        }
+        break;
+      default:
+        usage(argv[0]);
+        return 2;
+    }
+  }
+  if (optind != argc - 1 || cycles < 1) {
+    usage(argv[0]);
+    return 2;
+  }
+  config.file_dir = argv[optind];
+
+  double *samples = calloc((size_t)cycles * NUM_PHASES, sizeof(double));
+  FILE *csv = csv_path ? fopen(csv_path, "w") : NULL;
+  if (!samples || (csv_path && !csv)) {
+    perror("Failed to initialize");
+    return 1;
+  }
+  if (csv) {
+    fprintf(csv, "cycle");
+    for (int p = 0; p < NUM_PHASES; ++p) fprintf(csv, ",%s_ms", PHASE_NAMES[p]);
+    fprintf(csv, ",rss_kb,fds\n");
+  }
+
+  int fds_before = num_fds();
+  long rss_first = 0, rss_max = 0, rss = 0;
+  int fds = 0;
+
+  for (int i = 0; i < cycles; ++i) {
+    double *s = samples + (size_t)i * NUM_PHASES;
+    char config_path[4096];
+    struct launch_args args = {.config_path = config_path, .errlog_path = ""};
+    pthread_t thread;
+
+    double t0 = now_ms();
+    if (rnss_new_config_file(&config, config_path, sizeof(config_path))) {
+      perror("Failed to write the config file");
+      return 1;
+    }
+
+    double t_launch = now_ms();
+    launched = 0;
+    bind_ms = 0;
+    if (pthread_create(&thread, NULL, server_thread, &args)) {
+      perror("Failed to create the server thread");
+      return 1;
+    }
+
+    pthread_mutex_lock(&lock);
+    while (!launched) pthread_cond_wait(&cond, &lock);
+    int ok = launched > 0;
+    double t_bind = bind_ms;
+    pthread_mutex_unlock(&lock);
+    double t_launched = now_ms();
+    unlink(config_path);
+
+    if (!ok) {
+      pthread_join(thread, NULL);
+      fprintf(stderr, "Cycle %d: server exited with status %d before launch\n",
+        i, args.res);
+      return 1;
+    }
+
+    if (first_byte(config.hostname, config.port)) {
+      fprintf(stderr, "Cycle %d: request to the server failed\n", i);
+    }
+    double t_first_byte = now_ms();
+
+    lighttpd_graceful_shutdown();
+    pthread_join(thread, NULL);
+    double t_end = now_ms();
+    if (args.res) {
+      fprintf(stderr, "Cycle %d: server exited with status %d\n", i, args.res);
+      return 1;
+    }
+
+    s[PHASE_CONFIG_WRITE] = t_launch - t0;
+    s[PHASE_PRE_BIND] = (t_bind ? t_bind : t_launched) - t_launch;
+    s[PHASE_POST_BIND] = t_launched - (t_bind ? t_bind : t_launched);
+    s[PHASE_FIRST_BYTE] = t_first_byte - t_launched;
+    s[PHASE_SHUTDOWN] = t_end - t_first_byte;
+    s[PHASE_TOTAL] = t_end - t0;
+
+    rss = rss_kb();
+    fds = num_fds();
+    if (i == 0) rss_first = rss;
+    if (rss > rss_max) rss_max = rss;
+
+    if (csv) {
+      fprintf(csv, "%d", i);
+      for (int p = 0; p < NUM_PHASES; ++p) fprintf(csv, ",%.3f", s[p]);
+      fprintf(csv, ",%ld,%d\n", rss, fds);
+    }
+  }
+  if (csv) fclose(csv);
+
+  printf("%d cycles\n%-18s %10s %10s %10s %10s\n", cycles, "phase",
+    "p50 ms", "p99 ms", "max ms", "mean ms");
+  double *col = malloc(cycles * sizeof(double));
+  for (int p = 0; p < NUM_PHASES; ++p) {
+    double sum = 0;
+    for (int i = 0; i < cycles; ++i) {
+      col[i] = samples[(size_t)i * NUM_PHASES + p];
+      sum += col[i];
+    }
+    qsort(col, cycles, sizeof(double), compare_doubles);
+    printf("%-18s %10.3f %10.3f %10.3f %10.3f\n", PHASE_NAMES[p],
+      col[cycles / 2], col[(int)(0.99 * (cycles - 1))], col[cycles - 1],
+      sum / cycles);
+  }
+
+  printf("RSS: %ld KB after the first cycle, %ld KB after the last, %ld KB max\n",
+    rss_first, rss, rss_max);
+  printf("Open fds: %d before the first cycle, %d after the last\n",
+    fds_before, fds);
+
+  int res = 0;
+  if (fds - fds_before > max_fd_growth) {
+    fprintf(stderr, "FAIL: open fd count grew by %d\n", fds - fds_before);
+    res = 1;
+  }
+  if (rss - rss_first > max_rss_growth) {
+    fprintf(stderr, "FAIL: RSS grew by %ld KB\n", rss - rss_first);
+    res = 1;
+  }
+  return res;
+}
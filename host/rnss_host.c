@@ -0,0 +1,280 @@
+// Runs the library's Lighttpd server, built with the same static module set,
+// and the same standard config as in apps, as a standalone Linux process.
+// It allows to benchmark and profile the exact server configuration outside
+// of a mobile app.
+//
+// It prints server signals (LAUNCHED, TERMINATED, CRASHED) to stdout, one per
+// line, and gracefully shuts down the server on SIGINT, SIGTERM, or SIGHUP.
+//
+// When built with WITH_RNSS_TRACE option, it traces the server thread, and
+// dumps the trace into the working directory on SIGUSR1, and on exit.
+
+#include <getopt.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "standard_config.h"
+
+#ifdef RNSS_TRACE
+#include "trace.h"
+#endif
+
+#define MAX_DEBUG_OPS 16
+#define MAX_MIME_TYPES 64
+#define MAX_ROUTES 64
+
+int lighttpd_launch(
+  const char *config_path,
+  const char *module_path,
+  const char *errlog_path,
+  void (*cb)()
+);
+
+void lighttpd_graceful_shutdown();
+
+static pthread_mutex_t state_lock = PTHREAD_MUTEX_INITIALIZER;
+static int launched;
+static int shutdown_requested;
+static const char *origin_host;
+static int origin_port;
+static char config_path[4096];
+static const char *work_dir;
+
+#ifdef RNSS_TRACE
+static void dump_trace() {
+  char path[4096];
+  if (rnss_trace_dump(work_dir, path, sizeof(path))) {
+    perror("Failed to dump the trace");
+  } else fprintf(stderr, "Trace written to %s\n", path);
+}
+#endif
+
+static void on_launched() {
+  pthread_mutex_lock(&state_lock);
+  launched = 1;
+  printf("LAUNCHED http://%s:%d\n", origin_host, origin_port);
+  fflush(stdout);
+
+  // Similar to StaticServer.start() the config file is not needed anymore
+  // once the server has launched.
+  unlink(config_path);
+
+  // A shutdown signal might have arrived while the server was starting.
+  if (shutdown_requested) lighttpd_graceful_shutdown();
+  pthread_mutex_unlock(&state_lock);
+}
+
+static void *signal_watcher(void *arg) {
+  sigset_t *signals = arg;
+  int sig;
+  for (;;) {
+    if (sigwait(signals, &sig)) continue;
+#ifdef RNSS_TRACE
+    if (sig == SIGUSR1) {
+      dump_trace();
+      continue;
+    }
+#endif
+    pthread_mutex_lock(&state_lock);
+    shutdown_requested = 1;
+    if (launched) lighttpd_graceful_shutdown();
+    pthread_mutex_unlock(&state_lock);
+  }
+  return NULL;
+}
+
+static void usage(const char *name) {
+  fprintf(stderr,
+    "Usage: %s [options] <fileDir>\n"
+    "  -a, --access-log           Write the access log next to the config file.\n"
+    "  -h, --hostname <address>   Address to bind to (default: 127.0.0.1).\n"
+    "  -p, --port <port>          Port to listen at (default: 8080).\n"
+    "  -w, --work-dir <dir>       Working directory for configs, logs,\n"
+    "                             and uploads (default: /tmp/__rn-static-server__).\n"
+    "  -e, --error-log            Log into <work-dir>/errorlog.txt,\n"
+    "                             rather than into the system log.\n"
+    "  -d, --debug <option>       Enable Lighttpd debug option, e.g.\n"
+    "                             \"request-handling\"; implies --error-log.\n"
+    "  -s, --status-url <path>    Serve the server status page (mod_status)\n"
+    "                             at this URL path.\n"
+    "      --memory-limit <bytes> Cap the count of concurrent connections\n"
+    "                             to keep their memory within the limit.\n"
+    "  -m, --mime-type <ext>=<type>\n"
+    "                             Add, or override, the MIME type of files\n"
+    "                             with the extension.\n"
+    "  -r, --route '[exact:|regex:]<path> <config>'\n"
+    "                             Apply the config directives to requests\n"
+    "                             matched by the route (prefix match, unless\n"
+    "                             specified otherwise). A single argument:\n"
+    "                             the path ends at its first space, e.g.\n"
+    "                             --route '/dav/ webdav.activate = \"enable\"'.\n"
+    "      --spa-fallback <path>  Answer requests for missing files with\n"
+    "                             the file at this URL path.\n"
+    "  -x, --extra-config <file>  Append the content of the file to the config.\n"
+    "      --webdav <regex>       Enable WebDAV for matching URLs (same as\n"
+    "                             the deprecated `webdav` option).\n",
+    name);
+}
+
+int main(int argc, char **argv) {
+  static const struct option options[] = {
+    {"access-log", no_argument, NULL, 'a'},
+    {"debug", required_argument, NULL, 'd'},
+    {"error-log", no_argument, NULL, 'e'},
+    {"extra-config", required_argument, NULL, 'x'},
+    {"help", no_argument, NULL, '?'},
+    {"hostname", required_argument, NULL, 'h'},
+    {"memory-limit", required_argument, NULL, 'M'},
+    {"mime-type", required_argument, NULL, 'm'},
+    {"port", required_argument, NULL, 'p'},
+    {"route", required_argument, NULL, 'r'},
+    {"spa-fallback", required_argument, NULL, 'F'},
+    {"status-url", required_argument, NULL, 's'},
+    {"webdav", required_argument, NULL, 'W'},
+    {"work-dir", required_argument, NULL, 'w'},
+    {NULL, 0, NULL, 0},
+  };
+
+  const char *debug_ops[MAX_DEBUG_OPS + 1] = {NULL};
+  const char *mime_types[2 * MAX_MIME_TYPES + 1] = {NULL};
+  struct rnss_route routes[MAX_ROUTES + 1] = {{NULL}};
+  const char *webdav[RNSS_MAX_WEBDAV_ROUTES + 1] = {NULL};
+  int num_debug_ops = 0, num_mime_types = 0, num_routes = 0, num_webdav = 0;
+  int opt;
+  char *sep;
+
+  struct rnss_config config = {
+    .hostname = "127.0.0.1",
+    .port = 8080,
+    .work_dir = "/tmp/__rn-static-server__",
+    .debug_ops = debug_ops,
+    .mime_types = mime_types,
+    .routes = routes,
+    .webdav = webdav,
+  };
+
+  while ((opt = getopt_long(argc, argv, "ad:eh:m:p:r:s:w:x:", options, NULL)) != -1) {
+    switch (opt) {
+      case 'a': config.access_log = 1; break;
+      case 'd':
+        if (num_debug_ops == MAX_DEBUG_OPS) {
+          fprintf(stderr, "Too many debug options\n");
+          return 2;
+        }
+        debug_ops[num_debug_ops++] = optarg;
+        config.error_log = 1;
+        break;
+      case 'e': config.error_log = 1; break;
+      case 'F': config.spa_fallback = optarg; break;
+      case 'h': config.hostname = optarg; break;
+      case 'M': config.memory_limit = atoll(optarg); break;
+      case 'm':
+        sep = strchr(optarg, '=');
+        if (!sep || num_mime_types == MAX_MIME_TYPES) {
+          fprintf(stderr, "Invalid, or too many MIME types: %s\n", optarg);
+          return 2;
+        }
+        *sep = '\0';
+        mime_types[2 * num_mime_types] = optarg;
+        mime_types[2 * num_mime_types++ + 1] = sep + 1;
+        break;
+      case 'p': config.port = atoi(optarg); break;
+      case 'r':
+        sep = strchr(optarg, ' ');
+        if (!sep || num_routes == MAX_ROUTES) {
+          fprintf(stderr, "Invalid, or too many routes: %s\n", optarg);
+          return 2;
+        }
+        *sep = '\0';
+        routes[num_routes].config = sep + 1;
+        if (!strncmp(optarg, "exact:", 6)) {
+          routes[num_routes].match = RNSS_ROUTE_EXACT;
+          optarg += 6;
+        } else if (!strncmp(optarg, "regex:", 6)) {
+          routes[num_routes].match = RNSS_ROUTE_REGEX;
+          optarg += 6;
+        }
+        routes[num_routes++].path = optarg;
+        break;
+      case 's': config.status_url = optarg; break;
+      case 'w': config.work_dir = optarg; break;
+      case 'W':
+        if (num_webdav == RNSS_MAX_WEBDAV_ROUTES) {
+          fprintf(stderr, "Too many WebDAV routes\n");
+          return 2;
+        }
+        webdav[num_webdav++] = optarg;
+        break;
+      case 'x':
+        config.extra_config = rnss_read_extra_config(optarg);
+        if (!config.extra_config) {
+          perror(optarg);
+          return 2;
+        }
+        break;
+      default:
+        usage(argv[0]);
+        return 2;
+    }
+  }
+  if (optind != argc - 1) {
+    usage(argv[0]);
+    return 2;
+  }
+  config.file_dir = argv[optind];
+  origin_host = config.hostname;
+  origin_port = config.port;
+  work_dir = config.work_dir;
+
+  char errlog_path[4096] = "";
+  if (config.error_log
+    && rnss_error_log_file(&config, errlog_path, sizeof(errlog_path))) {
+    fprintf(stderr, "Working directory path is too long\n");
+    return 2;
+  }
+
+  if (rnss_new_config_file(&config, config_path, sizeof(config_path))) {
+    perror("Failed to create the config file");
+    return 1;
+  }
+
+  // Shutdown signals are blocked in all threads, and handled by the dedicated
+  // watcher thread, which asks the server to gracefully shut down.
+  static sigset_t signals;
+  sigemptyset(&signals);
+  sigaddset(&signals, SIGHUP);
+  sigaddset(&signals, SIGINT);
+  sigaddset(&signals, SIGTERM);
+#ifdef RNSS_TRACE
+  sigaddset(&signals, SIGUSR1);
+#endif
+  pthread_sigmask(SIG_BLOCK, &signals, NULL);
+
+  pthread_t watcher;
+  if (pthread_create(&watcher, NULL, signal_watcher, &signals)) {
+    perror("Failed to create the signal watcher thread");
+    return 1;
+  }
+
+#ifdef RNSS_TRACE
+  rnss_trace_thread();
+#endif
+
+  int res = lighttpd_launch(config_path, NULL, errlog_path, on_launched);
+
+#ifdef RNSS_TRACE
+  dump_trace();
+#endif
+
+  if (res) {
+    unlink(config_path);
+    printf("CRASHED Lighttpd exited with status %d\n", res);
+  } else printf("TERMINATED\n");
+  fflush(stdout);
+
+  return res ? 1 : 0;
+}
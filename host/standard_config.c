@@ -0,0 +1,516 @@
+#include "standard_config.h"
+#include "mime_types.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MAX_EXTRA_CONFIG_SIZE (1 << 20)
+
+static int mkdir_p(const char *path) {
+  if (mkdir(path, 0755) && errno != EEXIST) return -1;
+  return 0;
+}
+
+int rnss_uploads_dir(const struct rnss_config *config, char *buf, size_t size) {
+  int n = snprintf(buf, size, "%s/uploads", config->work_dir);
+  return n < 0 || (size_t)n >= size ? -1 : 0;
+}
+
+int rnss_error_log_file(const struct rnss_config *config, char *buf, size_t size) {
+  int n = snprintf(buf, size, "%s/errorlog.txt", config->work_dir);
+  return n < 0 || (size_t)n >= size ? -1 : 0;
+}
+
+// Mirrors errorLogConfig() from src/config.ts.
+static void write_error_log_config(FILE *f, const struct rnss_config *config) {
+  if (config->error_log) {
+    for (const char **op = config->debug_ops; op && *op; ++op) {
+      fprintf(f, "debug.log-%s = \"enable\"\n", *op);
+    }
+  } else fprintf(f, "server.errorlog-use-syslog = \"enable\"\n");
+}
+
+struct module {
+  const char *name;
+  const char *prefixes[3]; // NULL-terminated.
+};
+
+// Mirrors MODULES from src/config.ts.
+static const struct module MODULES[] = {
+  {"mod_h2", {NULL}},
+  {"mod_rewrite", {"url.rewrite", NULL}},
+  {"mod_redirect", {"url.redirect", NULL}},
+  {"mod_alias", {"alias.url", NULL}},
+  {"mod_access", {"url.access-", NULL}},
+  {"mod_setenv", {"setenv.", NULL}},
+  {"mod_evhost", {"evhost.", NULL}},
+  {"mod_simple_vhost", {"simple-vhost.", NULL}},
+  {"mod_expire", {"expire.", NULL}},
+  {"mod_fastcgi", {"fastcgi.", NULL}},
+  {"mod_scgi", {"scgi.", NULL}},
+  {"mod_webdav", {"webdav.", NULL}},
+  {"mod_status", {"status.", NULL}},
+  {"mod_indexfile", {"index-file.", "server.indexfiles", NULL}},
+  {"mod_dirlisting", {"dir-listing.", "server.dir-listing", NULL}},
+  {"mod_staticfile", {"static-file.", NULL}},
+  {"mod_accesslog", {"accesslog.", NULL}},
+};
+
+#define NUM_MODULES (sizeof(MODULES) / sizeof(MODULES[0]))
+
+// Mirrors CORE_PREFIXES from src/config.ts.
+static const char *const CORE_PREFIXES[] = {
+  "connection.", "debug.", "env.", "etag.", "mimetype.", "server.", "var.",
+  NULL
+};
+
+static int is_known_module(const char *name, size_t len) {
+  for (size_t i = 0; i < NUM_MODULES; ++i) {
+    if (strlen(MODULES[i].name) == len && !strncmp(MODULES[i].name, name, len)) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+static int is_used_module(const struct module *module, const char *config) {
+  char quoted[64];
+  if (!strcmp(module->name, "mod_h2") || !strcmp(module->name, "mod_staticfile")) {
+    return 1;
+  }
+  snprintf(quoted, sizeof(quoted), "\"%s\"", module->name);
+  if (strstr(config, quoted)) return 1;
+  for (const char *const *p = module->prefixes; *p; ++p) {
+    if (strstr(config, *p)) return 1;
+  }
+  return 0;
+}
+
+static int has_prefix(const char *key, size_t len, const char *const *prefixes) {
+  for (const char *const *p = prefixes; *p; ++p) {
+    size_t n = strlen(*p);
+    if (n <= len && !strncmp(key, *p, n)) return 1;
+  }
+  return 0;
+}
+
+static int is_known_directive(const char *key, size_t len) {
+  if (has_prefix(key, len, CORE_PREFIXES)) return 1;
+  for (size_t i = 0; i < NUM_MODULES; ++i) {
+    if (has_prefix(key, len, MODULES[i].prefixes)) return 1;
+  }
+  return 0;
+}
+
+// Mirrors hasUnknownDirectives() from src/config.ts: finds directive
+// assignments ("key.name = value", or "+=", ":="), and checks their keys.
+static int has_unknown_directives(const char *config) {
+  static const char KEY_CHARS[] = "abcdefghijklmnopqrstuvwxyz"
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789_-.";
+  for (const char *p = config; *p; ++p) {
+    if (*p < 'a' || *p > 'z') continue;
+    if (p > config && !strchr(" \t\n\r\f\v{", p[-1])) continue;
+    size_t len = strspn(p, KEY_CHARS);
+    const char *op = p + len;
+    while (*op == ' ' || *op == '\t') ++op;
+    if (*op == '+' || *op == ':') ++op;
+    int assignment = *op == '=' && op[1] != '=' && op[1] != '~' && op[1] != '>';
+    const char *dot = memchr(p, '.', len);
+    if (assignment && dot && dot > p && dot < p + len - 1
+        && !is_known_directive(p, len)) {
+      return 1;
+    }
+    p += len - 1;
+  }
+  return 0;
+}
+
+// Writes quoted names of the modules not pre-built with the library, but named
+// in the config; each name is written once.
+static void write_unknown_modules(FILE *f, const char *config, int *count) {
+  for (const char *p = config; (p = strstr(p, "\"mod_")); ++p) {
+    const char *name = p + 1;
+    size_t len = strspn(name, "abcdefghijklmnopqrstuvwxyz"
+      "ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789_");
+    if (name[len] != '"' || is_known_module(name, len)) continue;
+
+    // Skips the name, if it was already named earlier in the config.
+    const char *prev = config;
+    while ((prev = strstr(prev, "\"mod_")) && prev < p) {
+      if (!strncmp(prev, p, len + 2)) break;
+      ++prev;
+    }
+    if (prev && prev < p) continue;
+
+    fprintf(f, "%s\"%.*s\"", (*count)++ ? ", " : "", (int)len, name);
+  }
+}
+
+// Mirror the constants of connectionsConfig() from src/config.ts.
+#define CONNECTION_MEMORY (64 << 10)
+#define RAM_SHARE_DIVISOR 32
+#define MIN_CONNECTIONS 8
+#define LOW_END_RAM (3LL << 30)
+#define LOW_END_CORES 4
+#define LOW_END_KEEP_ALIVE_IDLE 2
+#define LOW_END_KEEP_ALIVE_REQUESTS 100
+
+// Writes "key = value" line, unless the extra config sets the key.
+static void write_limit(FILE *f, const struct rnss_config *config,
+                        const char *key, long long value) {
+  if (config->extra_config && strstr(config->extra_config, key)) return;
+  fprintf(f, "%s = %lld\n", key, value);
+}
+
+// Mirrors connectionsConfig() from src/config.ts, with the device info
+// (DEVICE_INFO in the library) of the host, and without overrides (they can be
+// set by the extra config).
+static void write_connections_config(FILE *f, const struct rnss_config *config) {
+  long long cores = sysconf(_SC_NPROCESSORS_ONLN);
+  long long pages = sysconf(_SC_PHYS_PAGES);
+  long long ram = pages > 0 ? pages * sysconf(_SC_PAGESIZE) : 0;
+  struct rlimit limit;
+  long long fd_limit = 0;
+  if (!getrlimit(RLIMIT_NOFILE, &limit) && limit.rlim_cur != RLIM_INFINITY) {
+    fd_limit = (long long)limit.rlim_cur;
+  }
+
+  long long max_fds = fd_limit / 2;
+  long long max_connections = 0;
+  if (max_fds) max_connections = max_fds / 2;
+  if (ram > 0) {
+    long long cap = ram / RAM_SHARE_DIVISOR / CONNECTION_MEMORY;
+    if (!max_connections || cap < max_connections) max_connections = cap;
+  }
+  if (config->memory_limit > 0) {
+    long long cap = config->memory_limit / CONNECTION_MEMORY;
+    if (!max_connections || cap < max_connections) max_connections = cap;
+  }
+  if ((max_fds || ram > 0 || config->memory_limit > 0)
+      && max_connections < MIN_CONNECTIONS) {
+    max_connections = MIN_CONNECTIONS;
+  }
+
+  int low_end = (ram > 0 && ram < LOW_END_RAM)
+    || (cores > 0 && cores <= LOW_END_CORES);
+
+  if (max_fds) write_limit(f, config, "server.max-fds", max_fds);
+  if (max_connections) {
+    write_limit(f, config, "server.max-connections", max_connections);
+  }
+  if (low_end) {
+    write_limit(f, config, "server.max-keep-alive-idle",
+      LOW_END_KEEP_ALIVE_IDLE);
+    write_limit(f, config, "server.max-keep-alive-requests",
+      LOW_END_KEEP_ALIVE_REQUESTS);
+  }
+}
+
+static int is_valid_mime_type(const char *ext, const char *type) {
+  static const char EXT_CHARS[] = "abcdefghijklmnopqrstuvwxyz"
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789_.+-";
+  return *ext && !ext[strspn(ext, EXT_CHARS)] && !strchr(type, '"');
+}
+
+// Returns the type given for the extension by the extra types (the last one,
+// if given more than once), or NULL.
+static const char *find_extra_type(const char **extra, const char *ext) {
+  const char *type = NULL;
+  for (const char **p = extra; p && *p; p += 2) {
+    if (!strcmp(*p, ext)) type = p[1];
+  }
+  return type;
+}
+
+// Mirrors mimeTypesConfig() from src/mimeTypes.ts: the default table, with
+// the types given for its extensions overridden by the extra types, followed
+// by the extra types for other extensions.
+static void write_mime_types_config(FILE *f, const char **extra) {
+  size_t num = sizeof(MIME_TYPES) / sizeof(MIME_TYPES[0]);
+  fprintf(f, "mimetype.assign = (\n");
+  for (size_t i = 0; i < num; ++i) {
+    const char *type = find_extra_type(extra, MIME_TYPES[i][0]);
+    fprintf(f, "  \".%s\" => \"%s\",\n", MIME_TYPES[i][0],
+      type ? type : MIME_TYPES[i][1]);
+  }
+  for (const char **p = extra; p && *p; p += 2) {
+    size_t i = 0;
+    while (i < num && strcmp(MIME_TYPES[i][0], *p)) ++i;
+    if (i < num) continue;
+    // Skips the extension, if it was already written for an earlier pair.
+    const char **q = extra;
+    while (q < p && strcmp(*q, *p)) q += 2;
+    if (q < p) continue;
+    fprintf(f, "  \".%s\" => \"%s\",\n", *p, find_extra_type(extra, *p));
+  }
+  fprintf(f, "  \"\" => \"application/octet-stream\"\n)\n");
+}
+
+// Mirrors accessLogConfig() from src/accessLog.ts, except the log goes into
+// a regular file (see access_log field of rnss_config).
+static void write_access_log_config(FILE *f, const char *config_path) {
+  fprintf(f, "server.modules += (\"mod_accesslog\")\n");
+  fprintf(f, "accesslog.filename = \"%s.accesslog\"\n", config_path);
+  fprintf(f, "accesslog.format = \"%%{%%s}t %%{us}T %%>s %%b %%I %%O %%U\"\n");
+}
+
+// A node of the routes trie, mirrors TrieNode from src/routes.ts; its
+// children are kept in the order of insertion.
+struct trie_node {
+  char key[5]; // The UTF-8 character leading to the node.
+  int exact; // An exact route ends at this node.
+  int prefix; // A prefix route ends at this node.
+  struct trie_node *first_child;
+  struct trie_node *last_child;
+  struct trie_node *next;
+};
+
+static void free_trie(struct trie_node *node) {
+  while (node) {
+    struct trie_node *next = node->next;
+    free_trie(node->first_child);
+    free(node);
+    node = next;
+  }
+}
+
+// Adds the path to the trie, one UTF-8 character per node, and returns
+// the node it ends at, or NULL on allocation failure.
+static struct trie_node *add_trie_path(struct trie_node *node, const char *path) {
+  while (*path) {
+    size_t len = 1;
+    while (len < 4 && (path[len] & 0xC0) == 0x80) ++len;
+    struct trie_node *child = node->first_child;
+    while (child && (strlen(child->key) != len
+      || strncmp(child->key, path, len))) {
+      child = child->next;
+    }
+    if (!child) {
+      child = calloc(1, sizeof(*child));
+      if (!child) return NULL;
+      memcpy(child->key, path, len);
+      if (node->last_child) node->last_child->next = child;
+      else node->first_child = child;
+      node->last_child = child;
+    }
+    node = child;
+    path += len;
+  }
+  return node;
+}
+
+static void write_escaped_key(FILE *f, const char *key) {
+  if (strchr("$()*+.?[]^{|}\\", *key)) fputc('\\', f);
+  fputs(key, f);
+}
+
+// Mirrors trieRegex() from src/routes.ts.
+static void write_trie_regex(FILE *f, const struct trie_node *node) {
+  // NOTE: Once a prefix route has matched, nothing else matters.
+  if (node->prefix) return;
+
+  int num_branches = node->exact;
+  for (const struct trie_node *c = node->first_child; c; c = c->next) {
+    ++num_branches;
+  }
+  if (num_branches != 1) fprintf(f, "(?:");
+  for (const struct trie_node *c = node->first_child; c; c = c->next) {
+    if (c != node->first_child) fputc('|', f);
+    write_escaped_key(f, c->key);
+    const struct trie_node *next = c;
+    while (!next->exact && !next->prefix && next->first_child
+      && !next->first_child->next) {
+      next = next->first_child;
+      write_escaped_key(f, next->key);
+    }
+    write_trie_regex(f, next);
+  }
+  if (node->exact) fprintf(f, "%s$", node->first_child ? "|" : "");
+  if (num_branches != 1) fputc(')', f);
+}
+
+// Mirrors the validation of routesRegex() from src/routes.ts.
+static int are_valid_routes(const struct rnss_route *routes) {
+  for (const struct rnss_route *r = routes; r && r->path; ++r) {
+    if (strchr(r->path, '"')) return 0;
+    if (r->match != RNSS_ROUTE_REGEX && strchr(r->path, '\\')) return 0;
+  }
+  return 1;
+}
+
+// Mirrors routesRegex() from src/routes.ts, for the given route, and the routes
+// after it with the same config.
+static int write_routes_regex(FILE *f, const struct rnss_route *group) {
+  struct trie_node root;
+  memset(&root, 0, sizeof(root));
+  int literal = 0, count = 0;
+  for (const struct rnss_route *r = group; r->path; ++r) {
+    if (r->match == RNSS_ROUTE_REGEX || strcmp(r->config, group->config)) {
+      continue;
+    }
+    struct trie_node *node = add_trie_path(&root, r->path);
+    if (!node) {
+      free_trie(root.first_child);
+      return -1;
+    }
+    if (r->match == RNSS_ROUTE_EXACT) node->exact = 1;
+    else node->prefix = 1;
+    literal = 1;
+  }
+  if (literal) {
+    fputc('^', f);
+    write_trie_regex(f, &root);
+    ++count;
+  }
+  free_trie(root.first_child);
+  for (const struct rnss_route *r = group; r->path; ++r) {
+    if (r->match == RNSS_ROUTE_REGEX && !strcmp(r->config, group->config)) {
+      fprintf(f, "%s(?:%s)", count++ ? "|" : "", r->path);
+    }
+  }
+  return 0;
+}
+
+// Mirrors routesConfig() from src/routes.ts.
+static int write_routes_config(FILE *f, const struct rnss_route *routes) {
+  for (const struct rnss_route *r = routes; r->path; ++r) {
+    // Skips the config, if it was already written for an earlier route.
+    const struct rnss_route *prev = routes;
+    while (prev < r && strcmp(prev->config, r->config)) ++prev;
+    if (prev < r) continue;
+
+    fprintf(f, "$HTTP[\"url\"] =~ \"");
+    if (write_routes_regex(f, r)) return -1;
+    fprintf(f, "\" {\n  %s\n}\n", r->config);
+  }
+  return 0;
+}
+
+// Mirrors modulesConfig() from src/config.ts.
+static void write_modules_config(FILE *f, const char *config) {
+  int count = 0;
+  fprintf(f, "server.modules := (");
+  for (size_t i = 0; i < NUM_MODULES; ++i) {
+    if (!strcmp(MODULES[i].name, "mod_indexfile")) {
+      write_unknown_modules(f, config, &count);
+    }
+    if (is_used_module(&MODULES[i], config)) {
+      fprintf(f, "%s\"%s\"", count++ ? ", " : "", MODULES[i].name);
+    }
+  }
+  fprintf(f, ")\n");
+  if (!has_unknown_directives(config)) {
+    fprintf(f, "server.compat-module-load = \"disable\"\n");
+  }
+}
+
+int rnss_new_config_file(
+  const struct rnss_config *config,
+  char *path,
+  size_t size
+) {
+  char uploads[4096];
+  struct timespec now;
+  FILE *f;
+  int n;
+
+  for (const char **p = config->mime_types; p && *p; p += 2) {
+    if (!p[1] || !is_valid_mime_type(*p, p[1])) {
+      errno = EINVAL;
+      return -1;
+    }
+  }
+  if (!are_valid_routes(config->routes)) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  // NOTE: Lighttpd exits with error right away if the specified uploads
+  // directory does not exist.
+  if (rnss_uploads_dir(config, uploads, sizeof(uploads))) {
+    errno = ENAMETOOLONG;
+    return -1;
+  }
+  if (mkdir_p(config->work_dir) || mkdir_p(uploads)) return -1;
+
+  clock_gettime(CLOCK_REALTIME, &now);
+  n = snprintf(path, size, "%s/config-%lld%03ld.txt", config->work_dir,
+    (long long)now.tv_sec, now.tv_nsec / 1000000);
+  if (n < 0 || (size_t)n >= size) {
+    errno = ENAMETOOLONG;
+    return -1;
+  }
+
+  f = fopen(path, "w");
+  if (!f) return -1;
+
+  fprintf(f, "server.document-root = \"%s\"\n", config->file_dir);
+  fprintf(f, "server.bind = \"%s\"\n", config->hostname);
+  fprintf(f, "server.upload-dirs = ( \"%s\" )\n", uploads);
+  fprintf(f, "server.port = %d\n", config->port);
+  write_error_log_config(f, config);
+  fprintf(f, "index-file.names += (\"index.xhtml\", \"index.html\", "
+    "\"index.htm\", \"default.htm\", \"index.php\")\n");
+
+  // NOTE: Lighttpd rejects duplicate assignment of the same config variable.
+  if (!config->extra_config || !strstr(config->extra_config, "mimetype.assign")) {
+    write_mime_types_config(f, config->mime_types);
+  }
+  write_connections_config(f, config);
+
+  if (config->access_log) write_access_log_config(f, path);
+
+  // Mirrors spaFallbackConfig() from src/config.ts.
+  if (config->spa_fallback) {
+    fprintf(f, "$HTTP[\"url\"] !~ \"\\.[^/]*$\" {\n"
+      "  server.error-handler-404 = \"%s\"\n}\n", config->spa_fallback);
+  }
+
+  if (config->status_url) {
+    fprintf(f, "server.modules += (\"mod_status\")\n");
+    fprintf(f, "status.status-url = \"%s\"\n", config->status_url);
+  }
+
+  if (config->webdav && *config->webdav) {
+    fprintf(f, "server.modules += (\"mod_webdav\")\n");
+    fprintf(f, "$HTTP[\"url\"] =~ \"");
+    for (const char **route = config->webdav; *route; ++route) {
+      fprintf(f, "%s(?:%s)", route == config->webdav ? "" : "|", *route);
+    }
+    fprintf(f, "\" { webdav.activate = \"enable\" }\n");
+  }
+
+  if (config->routes && write_routes_config(f, config->routes)) {
+    fclose(f);
+    return -1;
+  }
+
+  if (config->extra_config) fprintf(f, "%s\n", config->extra_config);
+
+  if (fclose(f)) return -1;
+
+  // The modules list depends on the entire config written above.
+  char *text = rnss_read_extra_config(path);
+  if (!text) return -1;
+  f = fopen(path, "a");
+  if (f) write_modules_config(f, text);
+  free(text);
+  if (!f || fclose(f)) return -1;
+  return 0;
+}
+
+char *rnss_read_extra_config(const char *path) {
+  FILE *f = fopen(path, "r");
+  if (!f) return NULL;
+  char *buf = malloc(MAX_EXTRA_CONFIG_SIZE + 1);
+  size_t len = buf ? fread(buf, 1, MAX_EXTRA_CONFIG_SIZE, f) : 0;
+  fclose(f);
+  if (buf) buf[len] = '\0';
+  return buf;
+}
@@ -0,0 +1,94 @@
+// C counterpart of standardConfig() from src/config.ts, used by host builds
+// to launch the server with exactly the same configuration as the library
+// generates within apps. Keep the two in sync!
+
+#pragma once
+
+#include <stddef.h>
+
+#define RNSS_MAX_WEBDAV_ROUTES 64
+
+// How a route path is matched against URL paths of requests, similar to
+// `match` field of Route type from src/routes.ts.
+enum rnss_route_match {
+  RNSS_ROUTE_PREFIX,
+  RNSS_ROUTE_EXACT,
+  RNSS_ROUTE_REGEX,
+};
+
+// A structured route, similar to Route type from src/routes.ts.
+struct rnss_route {
+  const char *config;
+  enum rnss_route_match match;
+  const char *path;
+};
+
+struct rnss_config {
+  const char *file_dir;
+  const char *hostname;
+  int port;
+
+  // Working directory for configs, logs, and uploads; it plays the role of
+  // WORK_DIR from src/config.ts.
+  const char *work_dir;
+
+  // Non-zero to log into the error log file, similar to `errorLog` option
+  // of StaticServer being set; otherwise the server logs into syslog.
+  int error_log;
+
+  // Lighttpd debug options to enable, e.g. "request-handling", similar to
+  // the flags of ErrorLogOptions; NULL-terminated.
+  const char **debug_ops;
+
+  // If positive, the count of concurrent connections is capped to keep their
+  // estimated memory within this limit (bytes), similar to `memoryLimit`
+  // option of standardConfig().
+  long long memory_limit;
+
+  // Non-zero to write the access log, similar to `accessLog` option of
+  // standardConfig(). As the host has no native log buffer to drain a FIFO,
+  // the log is written into a regular file next to the config file.
+  int access_log;
+
+  // Extra MIME types, similar to `mimeTypes` option of standardConfig(), as
+  // alternating file extensions and their MIME types; NULL-terminated.
+  const char **mime_types;
+
+  // Structured routes, similar to `routes` option of standardConfig();
+  // terminated by an entry with NULL path.
+  const struct rnss_route *routes;
+
+  // If not NULL, mod_status serves the server status page at this URL path,
+  // similar to `statusUrl` option of standardConfig().
+  const char *status_url;
+
+  // If not NULL, requests for missing files are answered with the file at this
+  // URL path, similar to `spaFallback` option of standardConfig().
+  const char *spa_fallback;
+
+  // DEPRECATED `webdav` option; NULL-terminated.
+  const char **webdav;
+
+  // Content of `extraConfig` option, may be NULL.
+  const char *extra_config;
+};
+
+// Writes into `buf` the path of the uploads directory for given config.
+int rnss_uploads_dir(const struct rnss_config *config, char *buf, size_t size);
+
+// Writes into `buf` the path of the error log file for given config.
+int rnss_error_log_file(const struct rnss_config *config, char *buf, size_t size);
+
+// Creates the working and uploads directories, if necessary, generates
+// the config file inside the working directory, and writes its path into
+// `path`. Returns 0 on success, -1 on failure (with errno set, EINVAL for
+// invalid MIME types, or route paths).
+int rnss_new_config_file(
+  const struct rnss_config *config,
+  char *path,
+  size_t size
+);
+
+// Reads the file at `path` (up to 1 MB) for `extra_config` field, into
+// a newly allocated string. Returns NULL on failure (with errno set).
+char *rnss_read_extra_config(const char *path);
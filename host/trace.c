@@ -0,0 +1,265 @@
+#define _GNU_SOURCE
+
+// NOTE: Fortified inline wrappers of the C library functions would clash with
+// the traced ones defined below.
+#undef _FORTIFY_SOURCE
+
+#include "trace.h"
+
+#include <dlfcn.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <time.h>
+#include <unistd.h>
+
+struct trace_event {
+  uint64_t ts; // Start, in ns of CLOCK_MONOTONIC.
+  uint64_t dur; // Duration, in ns.
+  const char *name; // NULL for connection spans.
+  int fd;
+  int res;
+};
+
+static struct trace_event ring[RNSS_TRACE_CAPACITY];
+
+// The total count of events written into the ring so far; the ring has only
+// one writer (the traced thread), so a release store is enough to publish
+// an event to the dumping thread.
+static atomic_uint_fast64_t ring_head;
+
+// Accept timestamps of currently open connections, by their fds.
+static uint64_t conn_start[RNSS_TRACE_MAX_FDS];
+
+static _Thread_local int traced;
+
+static uint64_t now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void record(const char *name, uint64_t ts, int fd, int res) {
+  uint64_t head = atomic_load_explicit(&ring_head, memory_order_relaxed);
+  struct trace_event *e = ring + head % RNSS_TRACE_CAPACITY;
+  e->ts = ts;
+  e->dur = now_ns() - ts;
+  e->name = name;
+  e->fd = fd;
+  e->res = res;
+  atomic_store_explicit(&ring_head, head + 1, memory_order_release);
+}
+
+static void on_accept(uint64_t ts, int fd) {
+  if (fd >= 0 && fd < RNSS_TRACE_MAX_FDS) conn_start[fd] = ts;
+}
+
+static void on_close(int fd) {
+  if (fd >= 0 && fd < RNSS_TRACE_MAX_FDS && conn_start[fd]) {
+    uint64_t ts = conn_start[fd];
+    conn_start[fd] = 0;
+    record(NULL, ts, fd, 0);
+  }
+}
+
+#define REAL(name) \
+  static __typeof__(name) *real_##name; \
+  if (!real_##name) real_##name = (__typeof__(name) *)dlsym(RTLD_NEXT, #name)
+
+// Defines a traced wrapper of the C library function `name`, which has
+// the given return type, parameters, and arguments, and `fd` expression
+// giving the file descriptor it deals with.
+#define TRACED(type, name, params, args, fd) \
+  type name params { \
+    REAL(name); \
+    if (!traced) return real_##name args; \
+    uint64_t ts = now_ns(); \
+    type res = real_##name args; \
+    record(#name, ts, fd, (int)res); \
+    return res; \
+  }
+
+TRACED(ssize_t, read, (int fd, void *buf, size_t n), (fd, buf, n), fd)
+TRACED(ssize_t, readv, (int fd, const struct iovec *iov, int n), (fd, iov, n), fd)
+TRACED(ssize_t, pread, (int fd, void *buf, size_t n, off_t off), (fd, buf, n, off), fd)
+TRACED(ssize_t, pread64, (int fd, void *buf, size_t n, off64_t off), (fd, buf, n, off), fd)
+TRACED(ssize_t, recv, (int fd, void *buf, size_t n, int flags), (fd, buf, n, flags), fd)
+TRACED(ssize_t, write, (int fd, const void *buf, size_t n), (fd, buf, n), fd)
+TRACED(ssize_t, writev, (int fd, const struct iovec *iov, int n), (fd, iov, n), fd)
+TRACED(ssize_t, send, (int fd, const void *buf, size_t n, int flags), (fd, buf, n, flags), fd)
+TRACED(ssize_t, sendfile, (int out, int in, off_t *off, size_t n), (out, in, off, n), out)
+TRACED(ssize_t, sendfile64, (int out, int in, off64_t *off, size_t n), (out, in, off, n), out)
+TRACED(int, stat, (const char *path, struct stat *buf), (path, buf), -1)
+TRACED(int, stat64, (const char *path, struct stat64 *buf), (path, buf), -1)
+TRACED(int, lstat, (const char *path, struct stat *buf), (path, buf), -1)
+TRACED(int, lstat64, (const char *path, struct stat64 *buf), (path, buf), -1)
+TRACED(int, fstat, (int fd, struct stat *buf), (fd, buf), fd)
+TRACED(int, fstat64, (int fd, struct stat64 *buf), (fd, buf), fd)
+TRACED(int, fstatat, (int dir, const char *path, struct stat *buf, int flags), (dir, path, buf, flags), -1)
+TRACED(int, fstatat64, (int dir, const char *path, struct stat64 *buf, int flags), (dir, path, buf, flags), -1)
+TRACED(int, epoll_wait, (int fd, struct epoll_event *ev, int n, int timeout), (fd, ev, n, timeout), fd)
+TRACED(int, poll, (struct pollfd *fds, nfds_t n, int timeout), (fds, n, timeout), -1)
+
+int accept(int fd, struct sockaddr *addr, socklen_t *len) {
+  REAL(accept);
+  if (!traced) return real_accept(fd, addr, len);
+  uint64_t ts = now_ns();
+  int res = real_accept(fd, addr, len);
+  record("accept", ts, fd, res);
+  on_accept(ts, res);
+  return res;
+}
+
+int accept4(int fd, struct sockaddr *addr, socklen_t *len, int flags) {
+  REAL(accept4);
+  if (!traced) return real_accept4(fd, addr, len, flags);
+  uint64_t ts = now_ns();
+  int res = real_accept4(fd, addr, len, flags);
+  record("accept4", ts, fd, res);
+  on_accept(ts, res);
+  return res;
+}
+
+int close(int fd) {
+  REAL(close);
+  if (!traced) return real_close(fd);
+  uint64_t ts = now_ns();
+  int res = real_close(fd);
+  record("close", ts, fd, res);
+  on_close(fd);
+  return res;
+}
+
+// open() variants are variadic, thus wrapped explicitly.
+#define TRACED_OPEN(name) \
+  int name(const char *path, int flags, ...) { \
+    mode_t mode = 0; \
+    if (flags & (O_CREAT | O_TMPFILE)) { \
+      va_list args; \
+      va_start(args, flags); \
+      mode = va_arg(args, mode_t); \
+      va_end(args); \
+    } \
+    REAL(name); \
+    if (!traced) return real_##name(path, flags, mode); \
+    uint64_t ts = now_ns(); \
+    int res = real_##name(path, flags, mode); \
+    record(#name, ts, res, res); \
+    return res; \
+  }
+
+#define TRACED_OPENAT(name) \
+  int name(int dir, const char *path, int flags, ...) { \
+    mode_t mode = 0; \
+    if (flags & (O_CREAT | O_TMPFILE)) { \
+      va_list args; \
+      va_start(args, flags); \
+      mode = va_arg(args, mode_t); \
+      va_end(args); \
+    } \
+    REAL(name); \
+    if (!traced) return real_##name(dir, path, flags, mode); \
+    uint64_t ts = now_ns(); \
+    int res = real_##name(dir, path, flags, mode); \
+    record(#name, ts, res, res); \
+    return res; \
+  }
+
+TRACED_OPEN(open)
+TRACED_OPEN(open64)
+TRACED_OPENAT(openat)
+TRACED_OPENAT(openat64)
+
+void rnss_trace_thread(void) {
+  traced = 1;
+}
+
+// Copies the ring content into `events` (of RNSS_TRACE_CAPACITY size), and
+// returns the range [first, head) of event numbers copied intact; the events
+// the traced thread may have overwritten during the copy are dropped.
+static uint64_t snapshot(struct trace_event *events, uint64_t *first) {
+  uint64_t head = atomic_load_explicit(&ring_head, memory_order_acquire);
+  memcpy(events, ring, sizeof(ring));
+  atomic_thread_fence(memory_order_acquire);
+  uint64_t last = atomic_load_explicit(&ring_head, memory_order_relaxed);
+
+  // The event #last may be half-written, thus events down to
+  // #(last - CAPACITY) share their slots with possibly overwritten ones.
+  *first = last >= RNSS_TRACE_CAPACITY ? last + 1 - RNSS_TRACE_CAPACITY : 0;
+  if (*first > head) *first = head;
+  return head;
+}
+
+static int dump(const char *dir, char *path, size_t size) {
+  struct timespec now;
+  clock_gettime(CLOCK_REALTIME, &now);
+  int n = snprintf(path, size, "%s/trace-%lld%03ld.json", dir,
+    (long long)now.tv_sec, now.tv_nsec / 1000000);
+  if (n < 0 || (size_t)n >= size) {
+    errno = ENAMETOOLONG;
+    return -1;
+  }
+
+  struct trace_event *events = malloc(sizeof(ring));
+  if (!events) return -1;
+  uint64_t first;
+  uint64_t head = snapshot(events, &first);
+
+  FILE *f = fopen(path, "w");
+  if (!f) {
+    free(events);
+    return -1;
+  }
+
+  int pid = getpid();
+
+  fprintf(f, "{\"traceEvents\":[\n");
+  fprintf(f, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":1,"
+    "\"args\":{\"name\":\"server\"}}", pid);
+  for (uint64_t i = first; i < head; ++i) {
+    const struct trace_event *e = events + i % RNSS_TRACE_CAPACITY;
+    double ts = e->ts / 1e3, dur = e->dur / 1e3;
+    if (e->name) {
+      fprintf(f, ",\n{\"name\":\"%s\",\"cat\":\"call\",\"ph\":\"X\","
+        "\"ts\":%.3f,\"dur\":%.3f,\"pid\":%d,\"tid\":1,"
+        "\"args\":{\"fd\":%d,\"res\":%d}}", e->name, ts, dur, pid, e->fd,
+        e->res);
+    } else {
+      // Connections overlap, thus they are written as async spans.
+      fprintf(f, ",\n{\"name\":\"connection\",\"cat\":\"connection\","
+        "\"ph\":\"b\",\"id\":%llu,\"ts\":%.3f,\"pid\":%d,\"tid\":1,"
+        "\"args\":{\"fd\":%d}}", (unsigned long long)i, ts, pid, e->fd);
+      fprintf(f, ",\n{\"name\":\"connection\",\"cat\":\"connection\","
+        "\"ph\":\"e\",\"id\":%llu,\"ts\":%.3f,\"pid\":%d,\"tid\":1}",
+        (unsigned long long)i, ts + dur, pid);
+    }
+  }
+  fprintf(f, "\n],\"otherData\":{\"dropped\":%llu}}\n",
+    (unsigned long long)first);
+
+  free(events);
+  return fclose(f) ? -1 : 0;
+}
+
+int rnss_trace_dump(const char *dir, char *path, size_t size) {
+  // NOTE: The dump's own calls are not traced, even when it is done by
+  // the traced thread (e.g. once the server has terminated).
+  int was_traced = traced;
+  traced = 0;
+  int res = dump(dir, path, size);
+  int err = errno;
+  traced = was_traced;
+  errno = err;
+  return res;
+}
@@ -0,0 +1,35 @@
+// Optional syscall-level tracing of the server thread, for the host build
+// (WITH_RNSS_TRACE option, see README.md in this folder).
+//
+// It interposes the C library calls the server does while handling requests
+// (accept, read, stat, open, sendfile, write, close, etc.), and records each
+// call made by the traced thread as a span into a fixed-size ring buffer,
+// along with a span per accepted connection, from its accept till its close.
+// The buffer can be dumped as Chrome trace-event JSON, to be opened in
+// Perfetto (https://ui.perfetto.dev), or chrome://tracing.
+//
+// When the option is off, this file is not compiled at all, and the server
+// runs with no tracing overhead.
+
+#pragma once
+
+#include <stddef.h>
+
+// Capacity of the ring buffer, in events; once it is full, the oldest events
+// are overwritten, and counted as dropped.
+#define RNSS_TRACE_CAPACITY (1 << 16)
+
+// Connections with fd numbers above this limit are not traced as spans
+// (their individual calls are still traced).
+#define RNSS_TRACE_MAX_FDS 4096
+
+// Enables tracing of the calling thread; only one thread can be traced.
+void rnss_trace_thread(void);
+
+// Writes the current content of the ring buffer, as Chrome trace-event JSON,
+// into the file `<dir>/trace-<ms>.json`, and writes its path into `path`.
+// It may be called from any thread, including the traced one, whose calls
+// are not traced during the dump. The ring is copied first, and the events
+// overwritten by the traced thread during the copy are counted as dropped.
+// Returns 0 on success, -1 on failure (with errno set).
+int rnss_trace_dump(const char *dir, char *path, size_t size);
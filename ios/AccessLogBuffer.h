@@ -0,0 +1,88 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Sampled binary access log.
+//
+// Lighttpd's mod_accesslog is configured (see src/accessLog.ts) to write
+// a minimal numeric record per request into a FIFO (fifoPath()); the reader
+// thread parses these lines, samples them, and stores the sampled records
+// into a fixed-size ring of compact binary records, overwriting the oldest
+// ones once the ring is full. Thus, neither the server thread, nor the storage
+// deal with the text log; the ring is exported in bulk on demand, in the binary
+// format documented in host/rnss_accesslog.c (the decoder tool).
+//
+// Besides, it keeps request counters over all parsed lines, sampled or not
+// (with zero capacity it keeps just the counters), reported by stats().
+class AccessLogBuffer {
+public:
+  // NOTE: The layout must match the binary format, and the host decoder.
+  struct Record {
+    uint32_t time; // Unix time (s) of the request.
+    uint32_t duration; // Request handling time (us).
+    uint32_t bytes; // Response body size.
+    uint32_t pathHash; // FNV-1a hash of the URL path.
+    uint16_t status; // HTTP status.
+    uint8_t cache; // Cache outcome, see CACHE_* constants.
+    uint8_t reserved;
+  };
+  static_assert(sizeof(Record) == 20, "Unexpected access log record size");
+
+  static const uint8_t CACHE_NONE = 0;
+  static const uint8_t CACHE_REVALIDATED = 1; // 304 Not Modified.
+
+  // The count of request handling time ranges counted by stats().
+  static const size_t LATENCY_RANGES = 8;
+
+  AccessLogBuffer(std::string fifoPath, size_t capacity, double sampleRate);
+  ~AccessLogBuffer();
+
+  const std::string& fifoPath() const { return _fifoPath; }
+
+  // Creates the FIFO, and starts the reader thread; returns false on failure.
+  bool start();
+
+  // Parses the remaining log content, and stops the reader thread;
+  // the records are kept in the ring, and can still be exported.
+  void stop();
+
+  // Writes the ring content, oldest records first, into the file at path;
+  // returns the count of written records, or -1 on failure (with errno set).
+  long exportTo(const std::string &path);
+
+  // Returns JSON with the request counters: the count of requests, bytes
+  // received and sent (with headers), counts of responses by status class
+  // (1xx - 5xx), counts of requests by handling time (LATENCY_BOUNDS_US
+  // ranges), and the time (s) since start().
+  std::string stats();
+
+private:
+  void read();
+  void parse(const char *line, size_t size);
+
+  std::string _fifoPath;
+  double _sampleRate;
+  double _sampleCredit = 0;
+  std::vector<char> _line;
+  int _fd = -1;
+  std::atomic<bool> _stopping{false};
+  std::thread _reader;
+
+  // NOTE: All fields below are guarded by _lock.
+  std::mutex _lock;
+  std::vector<Record> _ring;
+  uint64_t _written = 0; // Total count of records written into the ring.
+  uint64_t _seen = 0; // Total count of parsed log lines (requests).
+  uint64_t _bytesIn = 0;
+  uint64_t _bytesOut = 0;
+  std::array<uint64_t, LATENCY_RANGES> _latency = {};
+  std::array<uint64_t, 5> _statuses = {}; // 1xx - 5xx.
+  std::chrono::steady_clock::time_point _startedAt;
+};
@@ -0,0 +1,224 @@
+#import <Foundation/Foundation.h>
+
+#include "AccessLogBuffer.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <iterator>
+#include <poll.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const int POLL_INTERVAL_MS = 250;
+static const size_t READ_CHUNK_SIZE = 16384;
+
+// Max length of a log line; longer lines (i.e. huge URL paths) are cut,
+// which only affects their path hashes.
+static const size_t MAX_LINE_SIZE = 4096;
+
+// NOTE: It must match STATUS_URL_PREFIX in src/stats.ts.
+static const char INTERNAL_PATH_PREFIX[] = "/.rn-static-server/";
+
+// Upper bounds (us) of request handling time ranges counted by stats();
+// the last range is unbounded.
+// NOTE: They must match LATENCY_BOUNDS in src/stats.ts.
+static const uint32_t LATENCY_BOUNDS_US[] = {
+  1000, 5000, 10000, 50000, 100000, 500000, 1000000
+};
+static_assert(
+  std::size(LATENCY_BOUNDS_US) + 1 == AccessLogBuffer::LATENCY_RANGES,
+  "Unexpected count of latency ranges");
+
+// The header of exported files, see host/rnss_accesslog.c.
+struct ExportHeader {
+  char magic[8];
+  uint32_t recordSize;
+  uint32_t count;
+  uint64_t seen;
+  uint64_t overwritten;
+};
+static_assert(sizeof(ExportHeader) == 32, "Unexpected access log header size");
+
+static int hexDigit(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+// FNV-1a hash of the URL path, as logged by mod_accesslog, with its escape
+// sequences decoded; mod_accesslog escapes non-printable bytes, bytes above
+// 0x7E, double quotes, and backslashes in the path. Thus, the hash is taken
+// from the original path bytes, matching hashPath() in src/accessLog.ts.
+static uint32_t hashPath(const char *s, size_t size) {
+  // Escape sequences of mod_accesslog, besides "\xHH", and the characters
+  // they stand for.
+  static const char ESCAPES[] = "\"\\btnvr";
+  static const char UNESCAPED[] = "\"\\\b\t\n\v\r";
+
+  uint32_t hash = 2166136261u;
+  for (size_t i = 0; i < size; ++i) {
+    uint8_t c = s[i];
+    if (c == '\\' && i + 1 < size) {
+      int hi = s[i + 1] == 'x' && i + 3 < size ? hexDigit(s[i + 2]) : -1;
+      int lo = hi >= 0 ? hexDigit(s[i + 3]) : -1;
+      const char *escape = s[i + 1] ? strchr(ESCAPES, s[i + 1]) : nullptr;
+      if (lo >= 0) {
+        c = 16 * hi + lo;
+        i += 3;
+      } else if (escape) {
+        c = UNESCAPED[escape - ESCAPES];
+        ++i;
+      }
+    }
+    hash ^= c;
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+AccessLogBuffer::AccessLogBuffer(
+  std::string fifoPath,
+  size_t capacity,
+  double sampleRate
+):
+  _fifoPath(fifoPath),
+  _sampleRate(sampleRate),
+  _ring(capacity)
+{}
+
+AccessLogBuffer::~AccessLogBuffer() {
+  stop();
+}
+
+bool AccessLogBuffer::start() {
+  _startedAt = std::chrono::steady_clock::now();
+  unlink(_fifoPath.c_str());
+  if (mkfifo(_fifoPath.c_str(), 0600)) return false;
+
+  // NOTE: See the same trick in ErrorLogBuffer::start().
+  _fd = open(_fifoPath.c_str(), O_RDWR | O_NONBLOCK);
+  if (_fd < 0) return false;
+
+  _reader = std::thread(&AccessLogBuffer::read, this);
+  return true;
+}
+
+void AccessLogBuffer::stop() {
+  _stopping = true;
+  if (_reader.joinable()) _reader.join();
+  if (_fd >= 0) {
+    close(_fd);
+    _fd = -1;
+    unlink(_fifoPath.c_str());
+  }
+}
+
+void AccessLogBuffer::read() {
+  std::vector<char> buf(READ_CHUNK_SIZE);
+  struct pollfd pfd = { .fd = _fd, .events = POLLIN };
+  for (;;) {
+    ssize_t n = ::read(_fd, buf.data(), buf.size());
+    if (n > 0) {
+      for (ssize_t i = 0; i < n; ++i) {
+        if (buf[i] == '\n') {
+          parse(_line.data(), _line.size());
+          _line.clear();
+        } else if (_line.size() < MAX_LINE_SIZE) _line.push_back(buf[i]);
+      }
+    } else if (n < 0 && errno != EAGAIN && errno != EINTR) {
+      NSLog(@"Failed to read the access log: %s", strerror(errno));
+      break;
+    } else if (_stopping) break;
+    else poll(&pfd, 1, POLL_INTERVAL_MS);
+  }
+}
+
+// Parses a log line in the format
+// "<time> <duration> <status> <bytes> <bytes in> <bytes out> <path>"
+// (see src/accessLog.ts), accounts it in the counters, and adds it to
+// the ring, if sampled. Requests to the library's internal URL paths
+// (e.g. the status page) are skipped.
+void AccessLogBuffer::parse(const char *line, size_t size) {
+  std::string s(line, size);
+  const char *p = s.c_str();
+  char *end;
+  Record r = {};
+  r.time = (uint32_t)strtoul(p, &end, 10);
+  r.duration = (uint32_t)strtoul(end, &end, 10);
+  r.status = (uint16_t)strtoul(end, &end, 10);
+  // NOTE: Empty responses may have their size logged as "-".
+  r.bytes = (uint32_t)strtoul(end, &end, 10);
+  if (*end == ' ' && end[1] == '-') end += 2;
+  uint64_t bytesIn = strtoull(end, &end, 10);
+  uint64_t bytesOut = strtoull(end, &end, 10);
+  if (*end == ' ') ++end;
+  if (!strncmp(end, INTERNAL_PATH_PREFIX, sizeof(INTERNAL_PATH_PREFIX) - 1)) {
+    return;
+  }
+  r.pathHash = hashPath(end, s.c_str() + s.size() - end);
+  if (r.status == 304) r.cache = CACHE_REVALIDATED;
+
+  size_t bucket = 0;
+  while (bucket < std::size(LATENCY_BOUNDS_US)
+         && r.duration > LATENCY_BOUNDS_US[bucket]) ++bucket;
+
+  std::lock_guard lk(_lock);
+  ++_seen;
+  _bytesIn += bytesIn;
+  _bytesOut += bytesOut;
+  if (r.status >= 100 && r.status < 100 * (_statuses.size() + 1)) {
+    ++_statuses[r.status / 100 - 1];
+  }
+  ++_latency[bucket];
+  _sampleCredit += _sampleRate;
+  if (_sampleCredit < 1 || _ring.empty()) return;
+  _sampleCredit -= 1;
+  _ring[_written++ % _ring.size()] = r;
+}
+
+std::string AccessLogBuffer::stats() {
+  auto join = [](const auto &counts) {
+    std::string res;
+    for (auto count : counts) {
+      if (!res.empty()) res += ',';
+      res += std::to_string(count);
+    }
+    return res;
+  };
+
+  std::lock_guard lk(_lock);
+  auto uptime = std::chrono::duration_cast<std::chrono::seconds>(
+    std::chrono::steady_clock::now() - _startedAt).count();
+  return "{\"requests\":" + std::to_string(_seen)
+    + ",\"bytesIn\":" + std::to_string(_bytesIn)
+    + ",\"bytesOut\":" + std::to_string(_bytesOut)
+    + ",\"statuses\":[" + join(_statuses)
+    + "],\"latency\":[" + join(_latency)
+    + "],\"uptime\":" + std::to_string(uptime) + "}";
+}
+
+long AccessLogBuffer::exportTo(const std::string &path) {
+  FILE *out = fopen(path.c_str(), "wb");
+  if (!out) return -1;
+
+  std::lock_guard lk(_lock);
+  uint64_t count = std::min<uint64_t>(_written, _ring.size());
+  ExportHeader header = {
+    .magic = {'R', 'N', 'S', 'S', 'A', 'L', '0', '1'},
+    .recordSize = sizeof(Record),
+    .count = (uint32_t)count,
+    .seen = _seen,
+    .overwritten = _written - count
+  };
+  bool ok = fwrite(&header, sizeof(header), 1, out) == 1;
+  for (uint64_t i = _written - count; ok && i < _written; ++i) {
+    ok = fwrite(&_ring[i % _ring.size()], sizeof(Record), 1, out) == 1;
+  }
+  if (fclose(out)) ok = false;
+  return ok ? (long)count : -1;
+}
@@ -0,0 +1,34 @@
+#import <Foundation/Foundation.h>
+
+@class Server;
+
+typedef void (^AutostartSignalHandler)(Server *source, NSString *signal, NSString *details);
+
+// Native autostart of the server, to launch it from the app delegate's
+// application:didFinishLaunchingWithOptions:, in parallel with React Native
+// boot, rather than after the JS bundle has loaded, and called
+// StaticServer.start(). The JS layer later adopts the running server
+// (see "Native Autostart" in README.md).
+//
+// It is opted in by RNStaticServerAutostart dictionary in the app Info.plist:
+// - config (String) - Path of Lighttpd config file, relative to the app bundle;
+// - id (Number) - Optional. Server ID, for the JS layer; defaults 1.
+//
+// The config may refer to RNSS_BUNDLE_DIR, RNSS_DOCUMENT_DIR, and RNSS_WORK_DIR
+// environment variables (as env.RNSS_DOCUMENT_DIR, etc.), which are set to
+// the absolute paths of MainBundlePath, DocumentDirectoryPath, and the library's
+// WORK_DIR.
+@interface RNSSAutostart : NSObject
+
+// Launches the server, if opted in by the app Info.plist; it does not wait
+// for the launch, and it does nothing if called again.
++ (void) start;
+
+// Hands the autostarted server, if it is still running, over to the given
+// signal handler, which receives all its subsequent signals. Returns
+// the server, and sets launchDetails to its launch details (nil if it is
+// still starting).
++ (Server*) adopt:(AutostartSignalHandler)handler
+    launchDetails:(NSString**)launchDetails;
+
+@end
@@ -0,0 +1,97 @@
+#import "Autostart.h"
+#import "Server.h"
+
+static NSString * const INFO_PLIST_KEY = @"RNStaticServerAutostart";
+static const double DEFAULT_ID = 1;
+
+// NOTE: All variables below are guarded by @synchronized on RNSSAutostart.
+static Server *server;
+static NSString *launchDetails;
+static AutostartSignalHandler signalHandler;
+
+@implementation RNSSAutostart
+
++ (void) start
+{
+  NSDictionary *options = [NSBundle.mainBundle objectForInfoDictionaryKey:INFO_PLIST_KEY];
+  if (![options isKindOfClass:NSDictionary.class]) return;
+  NSString *config = options[@"config"];
+  if (![config isKindOfClass:NSString.class]) {
+    NSLog(@"RNSSAutostart: config path is missing in Info.plist");
+    return;
+  }
+  NSNumber *serverId = options[@"id"];
+  if (![serverId isKindOfClass:NSNumber.class]) serverId = @(DEFAULT_ID);
+
+  // NOTE: These must match MainBundlePath, DocumentDirectoryPath,
+  // and WORK_DIR of the JS layer.
+  NSString *bundleDir = NSBundle.mainBundle.bundlePath;
+  NSString *documentDir = NSSearchPathForDirectoriesInDomains(
+    NSDocumentDirectory, NSUserDomainMask, YES).firstObject;
+  NSString *workDir = [NSTemporaryDirectory()
+    stringByAppendingPathComponent:@"__rn-static-server__"];
+  [NSFileManager.defaultManager
+    createDirectoryAtPath:[workDir stringByAppendingPathComponent:@"uploads"]
+    withIntermediateDirectories:YES attributes:nil error:nil];
+  setenv("RNSS_BUNDLE_DIR", bundleDir.UTF8String, 1);
+  setenv("RNSS_DOCUMENT_DIR", documentDir.UTF8String, 1);
+  setenv("RNSS_WORK_DIR", workDir.UTF8String, 1);
+
+  NSString *configPath = [bundleDir stringByAppendingPathComponent:config];
+
+  @synchronized (self) {
+    if (server) return;
+    server = [Server
+      serverWithId:serverId
+      configPath:configPath
+      errlogPath:@""
+      errlogBufferSize:0
+      accessLogCapacity:0
+      accessLogSampleRate:1
+      stats:NO
+      signalConsumer:nil
+    ];
+    __weak Server *source = server;
+    server.signalConsumer = ^void(NSString * const signal,
+                                  NSString * const details)
+    {
+      [RNSSAutostart onSignal:signal details:details source:source];
+    };
+    server.qualityOfService = NSQualityOfServiceUserInteractive;
+    [server start];
+  }
+}
+
++ (Server*) adopt:(AutostartSignalHandler)handler
+    launchDetails:(NSString**)details
+{
+  @synchronized (self) {
+    if (!server) return nil;
+    signalHandler = handler;
+    *details = launchDetails;
+    return server;
+  }
+}
+
++ (void) onSignal:(NSString*)signal
+          details:(NSString*)details
+           source:(Server*)source
+{
+  AutostartSignalHandler handler;
+  @synchronized (self) {
+    handler = signalHandler;
+    if (!handler) {
+      if (signal == LAUNCHED) launchDetails = details;
+      else {
+        NSLog(@"Autostarted server exited: %@ %@", signal, details);
+        server = nil;
+      }
+    } else if (signal != LAUNCHED) {
+      server = nil;
+      signalHandler = nil;
+    }
+  }
+  if (handler) handler(source, signal, details);
+}
+
+@end
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Asynchronous buffered sink for the server error log.
+//
+// Lighttpd is given the path of a FIFO (fifoPath()) as its error log,
+// the reader thread drains that FIFO into a bounded in-memory ring,
+// and the flusher thread appends the ring content to the actual log file
+// (logPath) in large batched writes; or, if logPath is empty, it passes
+// batches of complete log lines to logConsumer. Thus, the server thread only
+// writes into the pipe buffer in memory, and never waits for the storage,
+// nor for the log consumer.
+//
+// If the ring overflows, the excess log bytes are dropped, and counted;
+// the count of dropped bytes is noted in the log with the next flush.
+class ErrorLogBuffer {
+public:
+  typedef std::function<void(const std::string &lines)> LogConsumer;
+
+  ErrorLogBuffer(
+    std::string fifoPath,
+    size_t capacity,
+    std::string logPath,
+    LogConsumer logConsumer);
+  ~ErrorLogBuffer();
+
+  const std::string& fifoPath() const { return _fifoPath; }
+
+  // Creates the FIFO, and starts the threads; returns false on failure.
+  bool start();
+
+  // Drains the remaining log content into the file, and releases resources.
+  // It should be called once the server has terminated.
+  void stop();
+
+  // Wakes up the flusher thread to flush the buffered log right away, e.g.
+  // on memory pressure, when the app may be killed soon.
+  void flushNow();
+
+private:
+  void read();
+  void push(const char *buf, size_t n);
+  bool nearlyFull() const;
+  void take(std::vector<char> &chunk, bool wholeLines);
+  void flush();
+
+  std::string _fifoPath;
+  std::string _logPath;
+  LogConsumer _logConsumer;
+  int _fd = -1;
+  std::atomic<bool> _stopping{false};
+
+  // The flusher coalesces the log for its interval, and it is woken up ahead
+  // of time only once the free space in the ring may not fit the next read
+  // from the FIFO, i.e. the ring is about to overflow.
+  size_t _overflowMargin;
+  std::thread _flusher;
+  std::thread _reader;
+
+  // NOTE: All fields below are guarded by _lock.
+  std::mutex _lock;
+  std::condition_variable _cv;
+  std::vector<char> _ring;
+  size_t _ringStart = 0;
+  size_t _ringSize = 0;
+  unsigned long long _dropped = 0;
+  bool _flushRequested = false;
+  bool _readerDone = false;
+};
@@ -0,0 +1,158 @@
+#import <Foundation/Foundation.h>
+
+#include "ErrorLogBuffer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const auto FLUSH_INTERVAL = std::chrono::milliseconds(1000);
+static const int POLL_INTERVAL_MS = 250;
+static const size_t READ_CHUNK_SIZE = 16384;
+
+// Max frequency of log batches passed to the log consumer.
+static const auto STREAM_INTERVAL = std::chrono::milliseconds(250);
+
+ErrorLogBuffer::ErrorLogBuffer(
+  std::string fifoPath,
+  size_t capacity,
+  std::string logPath,
+  LogConsumer logConsumer
+):
+  _fifoPath(fifoPath),
+  _logPath(logPath),
+  _logConsumer(logConsumer),
+  _overflowMargin(std::min(READ_CHUNK_SIZE, capacity / 2)),
+  _ring(capacity)
+{}
+
+ErrorLogBuffer::~ErrorLogBuffer() {
+  stop();
+}
+
+bool ErrorLogBuffer::start() {
+  unlink(_fifoPath.c_str());
+  if (mkfifo(_fifoPath.c_str(), 0600)) return false;
+
+  // NOTE: Opening the FIFO for both reading and writing does not block,
+  // and the reads never report EOF, no matter whether Lighttpd has the FIFO
+  // open or not.
+  _fd = open(_fifoPath.c_str(), O_RDWR | O_NONBLOCK);
+  if (_fd < 0) return false;
+
+  _reader = std::thread(&ErrorLogBuffer::read, this);
+  _flusher = std::thread(&ErrorLogBuffer::flush, this);
+  return true;
+}
+
+void ErrorLogBuffer::stop() {
+  _stopping = true;
+  if (_reader.joinable()) _reader.join();
+  if (_flusher.joinable()) _flusher.join();
+  if (_fd >= 0) {
+    close(_fd);
+    _fd = -1;
+    unlink(_fifoPath.c_str());
+  }
+}
+
+void ErrorLogBuffer::flushNow() {
+  std::lock_guard lk(_lock);
+  _flushRequested = true;
+  _cv.notify_all();
+}
+
+// NOTE: It must be called with _lock held.
+bool ErrorLogBuffer::nearlyFull() const {
+  return _ring.size() - _ringSize < _overflowMargin;
+}
+
+void ErrorLogBuffer::read() {
+  std::vector<char> buf(READ_CHUNK_SIZE);
+  struct pollfd pfd = { .fd = _fd, .events = POLLIN };
+  for (;;) {
+    ssize_t n = ::read(_fd, buf.data(), buf.size());
+    if (n > 0) push(buf.data(), n);
+    else if (n < 0 && errno != EAGAIN && errno != EINTR) {
+      NSLog(@"Failed to read the error log: %s", strerror(errno));
+      break;
+    } else if (_stopping) break;
+    else poll(&pfd, 1, POLL_INTERVAL_MS);
+  }
+  std::lock_guard lk(_lock);
+  _readerDone = true;
+  _cv.notify_all();
+}
+
+void ErrorLogBuffer::push(const char *buf, size_t n) {
+  std::lock_guard lk(_lock);
+  size_t size = std::min(n, _ring.size() - _ringSize);
+  size_t end = (_ringStart + _ringSize) % _ring.size();
+  size_t head = std::min(size, _ring.size() - end);
+  memcpy(_ring.data() + end, buf, head);
+  memcpy(_ring.data(), buf + head, size - head);
+  _ringSize += size;
+  _dropped += n - size;
+  if (nearlyFull()) _cv.notify_all();
+}
+
+// Takes out of the ring its content, or, if wholeLines is set, its content
+// up to the last line end (unless the ring is nearly full, or the reader is
+// done). It must be called with _lock held.
+void ErrorLogBuffer::take(std::vector<char> &chunk, bool wholeLines) {
+  size_t size = _ringSize;
+  if (wholeLines && !_readerDone && !nearlyFull()) {
+    while (size && _ring[(_ringStart + size - 1) % _ring.size()] != '\n') {
+      --size;
+    }
+  }
+  size_t head = std::min(size, _ring.size() - _ringStart);
+  chunk.assign(_ring.data() + _ringStart, _ring.data() + _ringStart + head);
+  chunk.insert(chunk.end(), _ring.data(), _ring.data() + size - head);
+  _ringStart = (_ringStart + size) % _ring.size();
+  _ringSize -= size;
+}
+
+void ErrorLogBuffer::flush() {
+  bool stream = _logPath.empty();
+  FILE *out = nullptr;
+  if (!stream) {
+    out = fopen(_logPath.c_str(), "a");
+    if (!out) NSLog(@"Failed to open the error log: %s", strerror(errno));
+  }
+
+  std::vector<char> chunk;
+  for (;;) {
+    unsigned long long drops;
+    bool done;
+    {
+      std::unique_lock lk(_lock);
+      _cv.wait_for(lk, stream ? STREAM_INTERVAL : FLUSH_INTERVAL, [this] {
+        return _readerDone || _flushRequested || nearlyFull();
+      });
+      _flushRequested = false;
+      done = _readerDone;
+      take(chunk, stream);
+      drops = _dropped;
+      _dropped = 0;
+    }
+    std::string note;
+    if (drops) {
+      note = "(RN Static Server: " + std::to_string(drops)
+        + " bytes of error log dropped)\n";
+    }
+    if (out) {
+      if (!chunk.empty()) fwrite(chunk.data(), 1, chunk.size(), out);
+      if (!note.empty()) fputs(note.c_str(), out);
+      fflush(out);
+    } else if (stream && _logConsumer && (!chunk.empty() || !note.empty())) {
+      _logConsumer(std::string(chunk.begin(), chunk.end()) + note);
+    }
+    if (done) break;
+  }
+  if (out) fclose(out);
+}
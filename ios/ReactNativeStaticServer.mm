@@ -1,37 +1,144 @@
 #import "ReactNativeStaticServer.h"
+#import "Autostart.h"
 #import "Server.h"
 #import "Errors.h"
+#import <UIKit/UIKit.h>
 #import <ifaddrs.h>
 #import <arpa/inet.h>
 #include <net/if.h>
+#include <stdlib.h>
+#include <sys/resource.h>
 
 static NSString * const EVENT_NAME = @"RNStaticServer";
-static dispatch_semaphore_t sem = dispatch_semaphore_create(1);
 
+// The size (bytes) of tokens generated by getRandomToken().
+static const size_t RANDOM_TOKEN_SIZE = 16;
+
+typedef NS_ENUM(NSInteger, ServerState) {
+  ServerStateIdle,
+  ServerStateStarting,
+  ServerStateActive,
+  ServerStateStopping
+};
+
+// A pending promise of start() or stop() call.
+@interface RNSSPromise : NSObject
+@property (copy) RCTPromiseResolveBlock resolve;
+@property (copy) RCTPromiseRejectBlock reject;
+@end
+
+@implementation RNSSPromise
+@end
+
+// The parameters of start() call, queued while the previous server stops.
+@interface RNSSStartRequest : NSObject
+@property NSNumber *serverId;
+@property NSString *configPath;
+@property NSString *errlogPath;
+@property NSUInteger errlogBufferSize;
+@property NSUInteger accessLogCapacity;
+@property double accessLogSampleRate;
+@property BOOL stats;
+@property NSQualityOfService qualityOfService;
+@property (readonly) NSMutableArray<RNSSPromise*> *promises;
+@end
+
+@implementation RNSSStartRequest
+- (instancetype)init {
+  self = [super init];
+  self->_promises = [NSMutableArray new];
+  return self;
+}
+@end
+
+// NOTE: The server lifecycle is a state machine, with all its fields guarded
+// by @synchronized(self); its transitions are triggered by start() and stop()
+// calls, and by signals from the server thread. The lock is only held for
+// the transitions themselves, and never while waiting for the server, thus
+// start() and stop() never block the calling thread; their promises are
+// queued, and settled by the server signals.
 @implementation ReactNativeStaticServer {
+    ServerState state;
     Server *server;
+    NSString *launchDetails;
+    NSMutableArray<RNSSPromise*> *startPromises;
+    NSMutableArray<RNSSPromise*> *stopPromises;
+
+    // Set when stop() is called while the server is starting; the server is
+    // stopped as soon as it is launched.
+    BOOL stopRequested;
+
+    // The start request received while the server is stopping (or is to be
+    // stopped); it is launched once the current server terminates, i.e.
+    // start() during stop becomes a restart.
+    RNSSStartRequest *nextStart;
 }
 
 RCT_EXPORT_MODULE();
 
 - (instancetype)init {
-  return [super init];
+  self = [super init];
+  self->state = ServerStateIdle;
+  self->startPromises = [NSMutableArray new];
+  self->stopPromises = [NSMutableArray new];
+
+  // Adopts the server launched by [RNSSAutostart start], if any, as if it was
+  // started by start() call.
+  @synchronized (self) {
+    NSString *adoptedDetails = nil;
+    __weak ReactNativeStaticServer *weakSelf = self;
+    Server *adopted = [RNSSAutostart
+      adopt:^void(Server *source, NSString *signal, NSString *details) {
+        [weakSelf onSignal:signal details:details source:source];
+      }
+      launchDetails:&adoptedDetails];
+    if (adopted) {
+      NSLog(@"Adopted autostarted server #%@", adopted.serverId);
+      self->server = adopted;
+      self->launchDetails = adoptedDetails;
+      self->state = adoptedDetails ? ServerStateActive : ServerStateStarting;
+    }
+  }
+
+  [[NSNotificationCenter defaultCenter]
+    addObserver:self
+    selector:@selector(onMemoryWarning:)
+    name:UIApplicationDidReceiveMemoryWarningNotification
+    object:nil];
+  return self;
 }
 
 - (void)invalidate
 {
+  [[NSNotificationCenter defaultCenter] removeObserver:self];
   [super invalidate];
-  if (self->server) {
-    [self stop:^void(id){}
-      reject:^void(NSString *a,NSString *b, NSError *c){}];
+  [self stop:^void(id){}
+    reject:^void(NSString *a,NSString *b, NSError *c){}];
+}
+
+- (void) onMemoryWarning:(NSNotification*)notification {
+  Server *server;
+  @synchronized (self) {
+    server = self->server;
   }
+  [server trimMemory];
 }
 
 - (NSDictionary*) constantsToExport {
+  // NOTE: 0 means the limit is unknown.
+  struct rlimit fdLimit = {0};
+  getrlimit(RLIMIT_NOFILE, &fdLimit);
+  if (fdLimit.rlim_cur == RLIM_INFINITY) fdLimit.rlim_cur = 0;
+
+  NSProcessInfo *info = [NSProcessInfo processInfo];
   return @{
     @"CRASHED": CRASHED,
+    @"DEVICE_CORES": @(info.activeProcessorCount),
+    @"DEVICE_FD_LIMIT": @(fdLimit.rlim_cur),
+    @"DEVICE_RAM": @(info.physicalMemory),
     @"IS_MAC_CATALYST": @(TARGET_OS_MACCATALYST),
     @"LAUNCHED": LAUNCHED,
+    @"LOG": LOG,
     @"TERMINATED": TERMINATED
   };
 }
@@ -40,11 +147,71 @@ RCT_EXPORT_MODULE();
   return [self constantsToExport];
 }
 
+RCT_REMAP_METHOD(dumpTrace,
+  dumpTrace:(NSString*)dir
+  resolve:(RCTPromiseResolveBlock)resolve
+  reject:(RCTPromiseRejectBlock)reject
+) {
+  // NOTE: The tracing relies on interposition of C library calls, which is
+  // not possible for a static library on Apple platforms.
+  [[RNSSException name:@"Tracing is not supported on iOS"] reject:reject];
+}
+
+RCT_REMAP_METHOD(exportAccessLog,
+  exportAccessLog:(NSString*)path
+  resolve:(RCTPromiseResolveBlock)resolve
+  reject:(RCTPromiseRejectBlock)reject
+) {
+  Server *server;
+  @synchronized (self) {
+    server = self->server;
+  }
+  long count = server ? [server exportAccessLog:path] : -1;
+  if (count < 0) {
+    [[RNSSException name:@"Failed to export the access log"
+                 details:server ? @(strerror(errno)) : @"No active server"]
+     reject:reject];
+  } else resolve(@(count));
+}
+
 RCT_REMAP_METHOD(getActiveServerId,
                  getActiveServerId:(RCTPromiseResolveBlock) resolve
                  reject:(RCTPromiseRejectBlock)reject
 ) {
-  resolve(self->server ? self->server.serverId : [NSNull null]);
+  Server *server;
+  @synchronized (self) {
+    server = self->server;
+  }
+  resolve(server ? server.serverId : [NSNull null]);
+}
+
+RCT_REMAP_METHOD(getStats,
+                 getStats:(RCTPromiseResolveBlock) resolve
+                 reject:(RCTPromiseRejectBlock)reject
+) {
+  Server *server;
+  @synchronized (self) {
+    server = self->server;
+  }
+  NSString *stats = [server stats];
+  if (stats) resolve(stats);
+  else {
+    [[RNSSException name:@"Failed to get server stats"
+                 details:@"No active server with stats"] reject:reject];
+  }
+}
+
+RCT_REMAP_METHOD(getRandomToken,
+                 getRandomToken:(RCTPromiseResolveBlock) resolve
+                 reject:(RCTPromiseRejectBlock)reject
+) {
+  // NOTE: On Apple platforms arc4random is a cryptographically secure
+  // generator, seeded by the kernel.
+  uint8_t bytes[RANDOM_TOKEN_SIZE];
+  arc4random_buf(bytes, sizeof(bytes));
+  NSMutableString *token = [NSMutableString stringWithCapacity:2 * sizeof(bytes)];
+  for (size_t i = 0; i < sizeof(bytes); ++i) [token appendFormat:@"%02x", bytes[i]];
+  resolve(token);
 }
 
 RCT_REMAP_METHOD(getLocalIpAddress,
@@ -83,73 +250,161 @@ RCT_REMAP_METHOD(getLocalIpAddress,
   }
 }
 
-RCTPromiseResolveBlock pendingResolve = nil;
-RCTPromiseRejectBlock pendingReject = nil;
-
 RCT_REMAP_METHOD(start,
   start:(double)_serverId
   configPath:(NSString*)configPath
   errlogPath:(NSString*)errlogPath
+  errlogBufferSize:(double)errlogBufferSize
+  accessLogCapacity:(double)accessLogCapacity
+  accessLogSampleRate:(double)accessLogSampleRate
+  stats:(BOOL)stats
+  threadPriority:(NSString*)threadPriority
+  bigCores:(BOOL)bigCores // NOTE: Not supported on iOS, ignored.
   resolve:(RCTPromiseResolveBlock)resolve
   reject:(RCTPromiseRejectBlock)reject
 ) {
-    NSLog(@"Starting the server...");
+  NSLog(@"Starting the server...");
+
+  NSNumber *serverId = [NSNumber numberWithDouble:_serverId];
+
+  RNSSStartRequest *request = [RNSSStartRequest new];
+  request.serverId = serverId;
+  request.configPath = configPath;
+  request.errlogPath = errlogPath;
+  request.errlogBufferSize = (NSUInteger)errlogBufferSize;
+  request.accessLogCapacity = (NSUInteger)accessLogCapacity;
+  request.accessLogSampleRate = accessLogSampleRate;
+  request.stats = stats;
+
+  // NOTE: On Apple platforms QoS class of a thread also drives its placement
+  // on performance vs. efficiency cores, thus there is no separate affinity
+  // control.
+  if ([threadPriority isEqualToString:@"interactive"]) {
+    request.qualityOfService = NSQualityOfServiceUserInteractive;
+  } else if ([threadPriority isEqualToString:@"utility"]) {
+    request.qualityOfService = NSQualityOfServiceUtility;
+  } else request.qualityOfService = NSQualityOfServiceDefault;
+
+  RNSSPromise *promise = [RNSSPromise new];
+  promise.resolve = resolve;
+  promise.reject = reject;
+
+  NSString *error = nil;
+  NSString *details = nil;
+  @synchronized (self) {
+    if (self->state == ServerStateStopping || self->stopRequested) {
+      RNSSStartRequest *next = self->nextStart;
+      if (next && ![next.serverId isEqualToNumber:serverId]) {
+        error = [NSString stringWithFormat:@"Failed to launch server #%@, another server instance (#%@) is pending", serverId, next.serverId];
+      } else {
+        if (!next) self->nextStart = request;
+        [self->nextStart.promises addObject:promise];
+      }
+    } else if (self->state == ServerStateIdle) {
+      [self launch:request];
+      [self->startPromises addObject:promise];
+    } else if (![self->server.serverId isEqualToNumber:serverId]) {
+      error = [NSString stringWithFormat:@"Failed to launch server #%@, another server instance (#%@) is active", serverId, self->server.serverId];
+    } else if (self->state == ServerStateStarting) {
+      [self->startPromises addObject:promise];
+    } else details = self->launchDetails;
+  }
 
-    NSNumber *serverId = [NSNumber numberWithDouble:_serverId];
+  if (error) [[[RNSSException name:error] log] reject:reject];
+  else if (details) resolve(details);
+}
 
-    dispatch_semaphore_wait(sem, DISPATCH_TIME_FOREVER);
+// Launches a new server; it must be called with the lock held.
+- (void) launch:(RNSSStartRequest*)request
+{
+  NSNumber *serverId = request.serverId;
+  Server *instance = [Server
+    serverWithId:serverId
+    configPath:request.configPath
+    errlogPath:request.errlogPath
+    errlogBufferSize:request.errlogBufferSize
+    accessLogCapacity:request.accessLogCapacity
+    accessLogSampleRate:request.accessLogSampleRate
+    stats:request.stats
+    signalConsumer:nil
+  ];
+
+  __weak Server *source = instance;
+  instance.signalConsumer = ^void(NSString * const signal,
+                                  NSString * const details)
+  {
+    [self onSignal:signal details:details source:source];
+  };
 
-    if (self->server) {
-      NSString *name = [NSString stringWithFormat:@"Failed to launch server #%@, another server instance (#%@) is active", serverId, self->server.serverId];
-      auto e = [[RNSSException name:name] log];
-      [e reject:reject];
-      dispatch_semaphore_signal(sem);
-      return;
-    }
+  instance.logConsumer = ^void(NSString * const lines) {
+    [self sendEventWithName:EVENT_NAME
+      body: @{
+        @"serverId": serverId,
+        @"event": LOG,
+        @"details": lines == nil ? @"" : lines
+      }
+    ];
+  };
 
-    if (pendingResolve != nil || pendingReject != nil) {
-      NSString *name = [NSString stringWithFormat:@"Internal error (server #%@)", serverId];
-      auto e = [[RNSSException name:name details:@"Non-expected pending promise"] log];
-      [e reject:reject];
-      dispatch_semaphore_signal(sem);
-      return;
-    }
+  instance.qualityOfService = request.qualityOfService;
 
-    pendingResolve = resolve;
-    pendingReject = reject;
-
-    SignalConsumer signalConsumer = ^void(NSString * const signal,
-                                          NSString * const details)
-    {
-      if (signal != LAUNCHED) self->server = nil;
-      if (pendingResolve == nil && pendingReject == nil) {
-        [self sendEventWithName:EVENT_NAME
-          body: @{
-            @"serverId": serverId,
-            @"event": signal,
-            @"details": details == nil ? @"" : details
-          }
-        ];
-      } else {
-        if (signal == CRASHED) {
-          NSString *name = [NSString stringWithFormat:@"Server #%@ crashed", serverId];
-          [[RNSSException name:name details:details]
-           reject:pendingReject];
-        } else pendingResolve(details);
-        pendingResolve = nil;
-        pendingReject = nil;
-        dispatch_semaphore_signal(sem);
+  self->server = instance;
+  self->state = ServerStateStarting;
+  self->launchDetails = nil;
+  [instance start];
+}
+
+- (void) onSignal:(NSString*)signal
+          details:(NSString*)details
+           source:(Server*)source
+{
+  NSArray<RNSSPromise*> *starts;
+  NSArray<RNSSPromise*> *stops = @[];
+  @synchronized (self) {
+    if (source == nil || source != self->server) return;
+    starts = [self->startPromises copy];
+    [self->startPromises removeAllObjects];
+    if (signal == LAUNCHED) {
+      self->state = ServerStateActive;
+      self->launchDetails = details;
+      if (self->stopRequested) {
+        self->stopRequested = NO;
+        self->state = ServerStateStopping;
+        [source cancel];
+      }
+    } else {
+      self->state = ServerStateIdle;
+      self->server = nil;
+      self->stopRequested = NO;
+      stops = [self->stopPromises copy];
+      [self->stopPromises removeAllObjects];
+      RNSSStartRequest *next = self->nextStart;
+      if (next) {
+        self->nextStart = nil;
+        [self launch:next];
+        [self->startPromises addObjectsFromArray:next.promises];
       }
-    };
+    }
+  }
 
-    self->server = [Server
-      serverWithId:serverId
-      configPath:configPath
-      errlogPath:errlogPath
-      signalConsumer:signalConsumer
+  if (starts.count == 0 && stops.count == 0) {
+    [self sendEventWithName:EVENT_NAME
+      body: @{
+        @"serverId": source.serverId,
+        @"event": signal,
+        @"details": details == nil ? @"" : details
+      }
     ];
-
-    [self->server start];
+  } else if (signal == CRASHED) {
+    NSString *name = [NSString stringWithFormat:@"Server #%@ crashed", source.serverId];
+    for (RNSSPromise *p in [starts arrayByAddingObjectsFromArray:stops]) {
+      [[RNSSException name:name details:details] reject:p.reject];
+    }
+  } else {
+    for (RNSSPromise *p in [starts arrayByAddingObjectsFromArray:stops]) {
+      p.resolve(details);
+    }
+  }
 }
 
 - (NSArray<NSString *> *)supportedEvents {
@@ -160,27 +415,41 @@ RCT_REMAP_METHOD(stop,
   stop:(RCTPromiseResolveBlock)resolve
   reject:(RCTPromiseRejectBlock)reject
 ) {
-  try {
-    if (self->server) {
-      NSLog(@"Stopping...");
-
-      dispatch_semaphore_wait(sem, DISPATCH_TIME_FOREVER);
-
-      if (pendingResolve != nil || pendingReject != nil) {
-        auto e = [[RNSSException name:@"Internal error"
-                            details:@"Unexpected pending promise"] log];
-        [e reject:reject];
-        dispatch_semaphore_signal(sem);
-        return;
-      }
+  NSLog(@"Stopping...");
+
+  RNSSPromise *promise = [RNSSPromise new];
+  promise.resolve = resolve;
+  promise.reject = reject;
+
+  RNSSStartRequest *cancelled;
+  BOOL stopped = NO;
+  @synchronized (self) {
+    cancelled = self->nextStart;
+    self->nextStart = nil;
+    switch (self->state) {
+      case ServerStateIdle:
+        stopped = YES;
+        break;
+      case ServerStateStarting:
+        self->stopRequested = YES;
+        break;
+      case ServerStateActive:
+        self->state = ServerStateStopping;
+        [self->server cancel];
+        break;
+      case ServerStateStopping:
+        break;
+    }
+    if (!stopped) [self->stopPromises addObject:promise];
+  }
 
-      pendingResolve = resolve;
-      pendingReject = reject;
-      [self->server cancel];
+  if (cancelled) {
+    NSString *name = [NSString stringWithFormat:@"Launch of server #%@ was cancelled by a stop request", cancelled.serverId];
+    for (RNSSPromise *p in cancelled.promises) {
+      [[RNSSException name:name] reject:p.reject];
     }
-  } catch (NSException *e) {
-    [[RNSSException from:e] reject:reject];
   }
+  if (stopped) resolve(nil);
 }
 
 RCT_REMAP_METHOD(getOpenPort,
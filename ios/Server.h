@@ -1,18 +1,50 @@
 static NSString * const CRASHED = @"CRASHED";
 static NSString * const LAUNCHED = @"LAUNCHED";
+static NSString * const LOG = @"LOG";
 static NSString * const TERMINATED = @"TERMINATED";
 
 typedef void (^SignalConsumer)(NSString * const signal, NSString * const details);
+typedef void (^LogConsumer)(NSString * const lines);
 
 @interface Server : NSThread
 - (void) cancel;
 - (void) main;
 
+// Writes the sampled access log of the server (if enabled) into the file
+// at path, in the binary format (see AccessLogBuffer.h); returns the count
+// of written records, or -1 on failure.
+- (long) exportAccessLog:(NSString*)path;
+
+// Returns JSON with the request counters of the server (see
+// AccessLogBuffer::stats()), or nil if it does not keep them.
+- (NSString*) stats;
+
+// Responds to memory pressure: flushes the buffered error log, if any,
+// and returns to the system the free memory kept by malloc for reuse
+// (e.g. the buffers released by Lighttpd).
+- (void) trimMemory;
+
+// Returns JSON with durations (ms) from the server object creation
+// (i.e. the native start() call) till the server thread start, till
+// lighttpd_launch() call, and till now (the LAUNCHED callback).
+- (NSString*) launchTimings;
+
+// If errlogBufferSize is positive, the error log is written asynchronously,
+// via ErrorLogBuffer of that size (bytes), into errlogPath, if set; otherwise
+// it is streamed to logConsumer. If accessLogCapacity is positive, the sampled
+// binary access log is kept, via AccessLogBuffer of that size (records);
+// if stats is set, the AccessLogBuffer is kept, even with zero capacity,
+// for its request counters.
 + (Server*) serverWithId:(NSNumber*)serverId
     configPath:(NSString*)configPath
     errlogPath:(NSString*)errlogPath
+    errlogBufferSize:(NSUInteger)errlogBufferSize
+    accessLogCapacity:(NSUInteger)accessLogCapacity
+    accessLogSampleRate:(double)accessLogSampleRate
+    stats:(BOOL)stats
     signalConsumer:(SignalConsumer)signalConsumer;
 
 @property (readonly) NSNumber *serverId;
 @property SignalConsumer signalConsumer;
+@property LogConsumer logConsumer;
 @end
@@ -1,9 +1,14 @@
 #import "Server.h"
+#include "AccessLogBuffer.h"
+#include "ErrorLogBuffer.h"
+
+#include <malloc/malloc.h>
+#include <memory>
 
 Server *activeServer;
 
 void onLaunchedCallback() {
-  activeServer.signalConsumer(LAUNCHED, nil);
+  activeServer.signalConsumer(LAUNCHED, [activeServer launchTimings]);
 }
 
 extern "C" {
@@ -20,17 +25,44 @@ extern "C" {
 @implementation Server {
   NSString *configPath;
   NSString *errlogPath;
+  NSUInteger errlogBufferSize;
+  NSUInteger accessLogCapacity;
+  double accessLogSampleRate;
+  BOOL stats;
+
+  // NOTE: It is guarded by @synchronized(self). The module drops its reference
+  // to the server once it terminates, thus the log can be exported only while
+  // the server is active.
+  std::shared_ptr<AccessLogBuffer> accessLog;
+
+  // NOTE: It is guarded by @synchronized(self).
+  std::shared_ptr<ErrorLogBuffer> errorLog;
+
+  // System uptime (seconds) at the launch phases, reported with LAUNCHED
+  // signal (see launchTimings).
+  NSTimeInterval createdAt;
+  NSTimeInterval launchCalledAt;
+  NSTimeInterval threadStartedAt;
 }
 
 - (id) initWithServerId:(NSNumber*)serverId
              configPath:(NSString*)configPath
              errlogPath:(NSString*)errlogPath
+       errlogBufferSize:(NSUInteger)errlogBufferSize
+      accessLogCapacity:(NSUInteger)accessLogCapacity
+    accessLogSampleRate:(double)accessLogSampleRate
+                  stats:(BOOL)stats
          signalConsumer:(SignalConsumer)signalConsumer
 {
   self = [super init];
+  self->createdAt = [NSProcessInfo processInfo].systemUptime;
   self->_serverId = serverId;
   self->configPath = configPath;
   self->errlogPath = errlogPath;
+  self->errlogBufferSize = errlogBufferSize;
+  self->accessLogCapacity = accessLogCapacity;
+  self->accessLogSampleRate = accessLogSampleRate;
+  self->stats = stats;
   self.signalConsumer = signalConsumer;
   return self;
 }
@@ -41,7 +73,35 @@ extern "C" {
   [super cancel];
 }
 
+- (long) exportAccessLog:(NSString*)path {
+  std::shared_ptr<AccessLogBuffer> log;
+  @synchronized (self) {
+    log = self->accessLog;
+  }
+  if (!log) return -1;
+  return log->exportTo([path cStringUsingEncoding:NSUTF8StringEncoding]);
+}
+
+- (NSString*) stats {
+  std::shared_ptr<AccessLogBuffer> log;
+  @synchronized (self) {
+    log = self->accessLog;
+  }
+  if (!log) return nil;
+  return [NSString stringWithUTF8String:log->stats().c_str()];
+}
+
+- (NSString*) launchTimings {
+  NSTimeInterval now = [NSProcessInfo processInfo].systemUptime;
+  return [NSString stringWithFormat:
+    @"{\"threadStart\":%.3f,\"launchCall\":%.3f,\"launched\":%.3f}",
+    1e3 * (self->threadStartedAt - self->createdAt),
+    1e3 * (self->launchCalledAt - self->createdAt),
+    1e3 * (now - self->createdAt)];
+}
+
 - (void) main {
+  self->threadStartedAt = [NSProcessInfo processInfo].systemUptime;
   NSLog(@"Server.main() triggered");
 
   if (activeServer) {
@@ -53,12 +113,47 @@ extern "C" {
 
   @try {
     activeServer = self;
+    std::string logPath = [self->errlogPath cStringUsingEncoding:NSASCIIStringEncoding];
+    if (self->errlogBufferSize > 0) {
+      LogConsumer logConsumer = self.logConsumer;
+      auto logBuffer = std::make_shared<ErrorLogBuffer>(
+        std::string([self->configPath cStringUsingEncoding:NSASCIIStringEncoding]) + ".errlog",
+        self->errlogBufferSize,
+        logPath,
+        [logConsumer](const std::string &lines) {
+          if (logConsumer) logConsumer([NSString stringWithUTF8String:lines.c_str()]);
+        });
+      if (!logBuffer->start()) {
+        [NSException raise:@"Failed to start error log buffer" format:@"%s", strerror(errno)];
+      }
+      logPath = logBuffer->fifoPath();
+      @synchronized (self) {
+        self->errorLog = logBuffer;
+      }
+    }
+    if (self->accessLogCapacity > 0 || self->stats) {
+      // NOTE: The FIFO path must match the one in the config generated by
+      // the JS layer (see src/accessLog.ts).
+      auto log = std::make_shared<AccessLogBuffer>(
+        std::string([self->configPath cStringUsingEncoding:NSASCIIStringEncoding]) + ".accesslog",
+        self->accessLogCapacity,
+        self->accessLogSampleRate);
+      if (!log->start()) {
+        [NSException raise:@"Failed to start access log buffer" format:@"%s", strerror(errno)];
+      }
+      @synchronized (self) {
+        self->accessLog = log;
+      }
+    }
+    self->launchCalledAt = [NSProcessInfo processInfo].systemUptime;
     int res = lighttpd_launch(
       [self->configPath cStringUsingEncoding:NSASCIIStringEncoding],
       nil,
-      [self->errlogPath cStringUsingEncoding:NSASCIIStringEncoding],
+      logPath.c_str(),
       onLaunchedCallback
     );
+    [self stopErrorLog];
+    [self stopAccessLog];
     if (res) [NSException raise:@"Server exited with error" format:@"%d", res];
 
     activeServer = NULL;
@@ -67,22 +162,58 @@ extern "C" {
     self.signalConsumer(TERMINATED, nil);
   }
   @catch (NSException *error) {
+    [self stopErrorLog];
+    [self stopAccessLog];
     activeServer = NULL;
     NSLog(@"Server crashed %@", error.name);
     self.signalConsumer(CRASHED, error.name);
   }
 }
 
+- (void) stopErrorLog {
+  std::shared_ptr<ErrorLogBuffer> log;
+  @synchronized (self) {
+    log = self->errorLog;
+    self->errorLog.reset();
+  }
+  if (log) log->stop();
+}
+
+- (void) trimMemory {
+  std::shared_ptr<ErrorLogBuffer> log;
+  @synchronized (self) {
+    log = self->errorLog;
+  }
+  if (log) log->flushNow();
+  malloc_zone_pressure_relief(NULL, 0);
+}
+
+- (void) stopAccessLog {
+  std::shared_ptr<AccessLogBuffer> log;
+  @synchronized (self) {
+    log = self->accessLog;
+  }
+  if (log) log->stop();
+}
+
 + (Server*) serverWithId:(NSNumber*)serverId
               configPath:(NSString*)configPath
               errlogPath:(NSString*)errlogPath
+        errlogBufferSize:(NSUInteger)errlogBufferSize
+       accessLogCapacity:(NSUInteger)accessLogCapacity
+     accessLogSampleRate:(double)accessLogSampleRate
+                   stats:(BOOL)stats
           signalConsumer:(SignalConsumer)signalConsumer
 {
   return [[Server alloc]
-    initWithServerId:serverId
-          configPath:configPath
-          errlogPath:errlogPath
-      signalConsumer:signalConsumer];
+       initWithServerId:serverId
+             configPath:configPath
+             errlogPath:errlogPath
+       errlogBufferSize:errlogBufferSize
+      accessLogCapacity:accessLogCapacity
+    accessLogSampleRate:accessLogSampleRate
+                  stats:stats
+         signalConsumer:signalConsumer];
 }
 
 @end
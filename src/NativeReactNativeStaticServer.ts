@@ -4,18 +4,46 @@ import { TurboModuleRegistry } from "react-native";
 export interface Spec extends TurboModule {
   readonly getConstants: () => {
     CRASHED: string;
+    DEVICE_CORES: number;
+    DEVICE_FD_LIMIT: number;
+    DEVICE_RAM: number;
     IS_MAC_CATALYST: boolean;
     LAUNCHED: string;
+    LOG: string;
     TERMINATED: string;
   };
 
   addListener(eventName: string): void;
 
+  // Writes the server trace into a file inside the given folder, and resolves
+  // to its path; supported only by Android builds with WITH_RNSS_TRACE option.
+  dumpTrace(dir: string): Promise<string>;
+
+  exportAccessLog(path: string): Promise<number>;
+
   getActiveServerId(): Promise<number | null>;
 
+  // Resolves to 32 hex digits (128 bits) from a cryptographically secure
+  // random source of the platform.
+  getRandomToken(): Promise<string>;
+
+  // Resolves to JSON with the request counters of the active server, started
+  // with `stats` flag (see src/stats.ts).
+  getStats(): Promise<string>;
+
   removeListeners(count: number): void;
 
-  start(id: number, configPath: string, errlogPath: string): Promise<string>;
+  start(
+    id: number,
+    configPath: string,
+    errlogPath: string,
+    errlogBufferSize: number,
+    accessLogCapacity: number,
+    accessLogSampleRate: number,
+    stats: boolean,
+    threadPriority: string,
+    bigCores: boolean,
+  ): Promise<string>;
 
   // TODO: Instead of implementing these methods in native code ourselves,
   // we probably can use `@react-native-community/netinfo` library to retrieve
@@ -0,0 +1,131 @@
+import { decodeAccessLog, hashPath } from "../accessLog";
+
+type RawRecord = [
+  time: number,
+  duration: number,
+  bytes: number,
+  pathHash: number,
+  status: number,
+  cache: number,
+];
+
+/**
+ * Encodes an access log export, as written by the native access log buffers.
+ */
+function encode(
+  records: RawRecord[],
+  seen: number,
+  overwritten: number,
+  recordSize = 20,
+): string {
+  const view = new DataView(new ArrayBuffer(32 + 20 * records.length));
+  "RNSSAL01".split("").forEach((c, i) => view.setUint8(i, c.charCodeAt(0)));
+  view.setUint32(8, recordSize, true);
+  view.setUint32(12, records.length, true);
+  view.setUint32(16, seen % 2 ** 32, true);
+  view.setUint32(20, Math.floor(seen / 2 ** 32), true);
+  view.setUint32(24, overwritten % 2 ** 32, true);
+  view.setUint32(28, Math.floor(overwritten / 2 ** 32), true);
+  records.forEach(([time, duration, bytes, pathHash, status, cache], i) => {
+    const pos = 32 + 20 * i;
+    view.setUint32(pos, time, true);
+    view.setUint32(pos + 4, duration, true);
+    view.setUint32(pos + 8, bytes, true);
+    view.setUint32(pos + 12, pathHash, true);
+    view.setUint16(pos + 16, status, true);
+    view.setUint8(pos + 18, cache);
+  });
+  return Buffer.from(view.buffer).toString("base64");
+}
+
+describe("decodeAccessLog()", () => {
+  it("decodes the header and records", () => {
+    const data = encode(
+      [
+        [1700000000, 850, 5120, 0x457c5a71, 200, 0],
+        [1700000001, 120, 0, 0x457c5a71, 304, 1],
+      ],
+      2,
+      0,
+    );
+    expect(decodeAccessLog(data)).toEqual({
+      overwritten: 0,
+      records: [
+        {
+          bytes: 5120,
+          cache: "none",
+          duration: 850,
+          pathHash: 0x457c5a71,
+          status: 200,
+          time: 1700000000,
+        },
+        {
+          bytes: 0,
+          cache: "revalidated",
+          duration: 120,
+          pathHash: 0x457c5a71,
+          status: 304,
+          time: 1700000001,
+        },
+      ],
+      seen: 2,
+    });
+  });
+
+  it("decodes a wrapped-around ring, oldest record first", () => {
+    // A ring of 3 records, after 5 sampled requests out of 10 seen.
+    const records: RawRecord[] = [3, 4, 5].map((i) => [
+      1700000000 + i,
+      i,
+      i,
+      i,
+      200,
+      0,
+    ]);
+    const log = decodeAccessLog(encode(records, 10, 2));
+    expect(log.overwritten).toBe(2);
+    expect(log.seen).toBe(10);
+    expect(log.records.map((it) => it.time)).toEqual([
+      1700000003, 1700000004, 1700000005,
+    ]);
+  });
+
+  it("decodes 64-bit counters", () => {
+    const log = decodeAccessLog(encode([], 2 ** 32 + 7, 2 ** 32 + 3));
+    expect(log).toEqual({
+      overwritten: 2 ** 32 + 3,
+      records: [],
+      seen: 2 ** 32 + 7,
+    });
+  });
+
+  it("skips a truncated trailing record", () => {
+    const data = Buffer.from(
+      encode([[1700000000, 1, 1, 1, 200, 0]], 1, 0),
+      "base64",
+    );
+    const truncated = data.subarray(0, data.length - 1).toString("base64");
+    expect(decodeAccessLog(truncated).records).toEqual([]);
+  });
+
+  it("rejects invalid data", () => {
+    expect(() => decodeAccessLog("")).toThrow("Invalid access log data");
+    expect(() => decodeAccessLog(encode([], 0, 0, 24))).toThrow(
+      "Invalid access log data",
+    );
+    const data = Buffer.from(encode([], 0, 0), "base64");
+    data[0] = 0x58;
+    expect(() => decodeAccessLog(data.toString("base64"))).toThrow(
+      "Invalid access log data",
+    );
+  });
+});
+
+describe("hashPath()", () => {
+  it("hashes UTF-8 bytes of the path with FNV-1a", () => {
+    expect(hashPath("")).toBe(0x811c9dc5);
+    expect(hashPath("a")).toBe(0xe40c292c);
+    expect(hashPath("/index.html")).toBe(0x457c5a71);
+    expect(hashPath("/é")).toBe(0x23a5a38a);
+  });
+});
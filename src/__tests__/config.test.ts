@@ -0,0 +1,112 @@
+import {
+  ASSET_PATH_REGEX,
+  connectionsConfig,
+  maxConnections,
+  modulesConfig,
+  spaFallbackConfig,
+} from "../config";
+
+jest.mock("@dr.pogodin/react-native-fs", () => ({
+  mkdir: jest.fn(),
+  TemporaryDirectoryPath: "/tmp",
+  writeFile: jest.fn(),
+}));
+
+const GB = 2 ** 30;
+
+describe("connectionsConfig()", () => {
+  it("reduces keep-alive limits on devices with less than 3 GB RAM", () => {
+    const config = connectionsConfig(
+      { cores: 8, fdLimit: 0, ram: 2 * GB },
+      {},
+      undefined,
+      "",
+    );
+    expect(config).toContain("server.max-keep-alive-idle = 2");
+    expect(config).toContain("server.max-keep-alive-requests = 100");
+  });
+
+  it("keeps Lighttpd keep-alive defaults on high-end devices", () => {
+    const config = connectionsConfig(
+      { cores: 8, fdLimit: 0, ram: 8 * GB },
+      {},
+      undefined,
+      "",
+    );
+    expect(config).not.toContain("server.max-keep-alive-idle");
+    expect(config).not.toContain("server.max-keep-alive-requests");
+  });
+});
+
+describe("maxConnections()", () => {
+  it("caps connections to fit into the memory limit", () => {
+    const device = { cores: 8, fdLimit: 32768, ram: 8 * GB };
+    expect(maxConnections(device, {}, 2 ** 20)).toBe(16);
+    expect(maxConnections(device, {}, 2 ** 16)).toBe(8);
+    expect(maxConnections(device, { maxConnections: 4 }, 2 ** 20)).toBe(4);
+  });
+});
+
+describe("modulesConfig()", () => {
+  const COMPAT_OFF = 'server.compat-module-load = "disable"';
+
+  it("loads only the always loaded modules for an empty config", () => {
+    expect(modulesConfig("")).toBe(
+      `server.modules := ("mod_h2", "mod_staticfile")\n  ${COMPAT_OFF}`,
+    );
+  });
+
+  it("infers modules from their directives, in the loading order", () => {
+    const config = modulesConfig(`server.dir-listing = "enable"
+      $HTTP["url"] =~ "^/dav/" {
+        webdav.activate = "enable"
+        url.rewrite-once = ("^/dav/a" => "/dav/b")
+      }`);
+    expect(config).toContain(
+      'server.modules := ("mod_h2", "mod_rewrite", "mod_webdav", ' +
+        '"mod_dirlisting", "mod_staticfile")',
+    );
+    expect(config).toContain(COMPAT_OFF);
+  });
+
+  it("keeps modules named in the config in front of request handlers", () => {
+    const config = modulesConfig('server.modules += ("mod_deflate")');
+    expect(config).toContain(
+      'server.modules := ("mod_h2", "mod_deflate", "mod_staticfile")',
+    );
+    expect(config).toContain(COMPAT_OFF);
+  });
+
+  it("keeps loading of default modules for unknown directives", () => {
+    let config = modulesConfig(`server.modules += ("mod_auth")
+      auth.backend = "plain"`);
+    expect(config).toBe(
+      'server.modules := ("mod_h2", "mod_auth", "mod_staticfile")',
+    );
+
+    config = modulesConfig('magnet.attract-raw-url-to = ("/a.lua")');
+    expect(config).not.toContain(COMPAT_OFF);
+  });
+});
+
+describe("spaFallbackConfig()", () => {
+  const assetPath = new RegExp(ASSET_PATH_REGEX);
+
+  it("scopes the fallback to URL paths without extensions", () => {
+    const config = spaFallbackConfig("/index.html");
+    expect(config).toContain('$HTTP["url"] !~ "\\.[^/]*$" {');
+    expect(config).toContain('server.error-handler-404 = "/index.html"');
+  });
+
+  it("does not fall back for missing assets", () => {
+    expect(assetPath.test("/assets/main.js")).toBe(true);
+    expect(assetPath.test("/styles.css")).toBe(true);
+    expect(assetPath.test("/img/logo.min.png")).toBe(true);
+  });
+
+  it("falls back for deep links", () => {
+    expect(assetPath.test("/")).toBe(false);
+    expect(assetPath.test("/settings/profile")).toBe(false);
+    expect(assetPath.test("/v1.2/users")).toBe(false);
+  });
+});
@@ -0,0 +1,41 @@
+import { mimeTypesConfig } from "../mimeTypes";
+
+describe("mimeTypesConfig()", () => {
+  it("assigns the default types, with the fallback last", () => {
+    const config = mimeTypesConfig();
+    expect(config).toMatch(/^mimetype\.assign = \(/);
+    expect(config).toContain('".html" => "text/html; charset=utf-8"');
+    expect(config).toContain('".wasm" => "application/wasm"');
+    expect(config).toMatch(/"" => "application\/octet-stream"\n {2}\)$/);
+    expect(mimeTypesConfig()).toBe(config);
+  });
+
+  it("merges extra types into the default table", () => {
+    const config = mimeTypesConfig({
+      md: "text/plain; charset=utf-8",
+      usdz: "model/vnd.usdz+zip",
+    });
+    expect(config).toContain('".md" => "text/plain; charset=utf-8"');
+    expect(config).not.toContain("text/markdown");
+    expect(config).toContain('".usdz" => "model/vnd.usdz+zip"');
+    expect(config).toContain('".html" => "text/html; charset=utf-8"');
+    expect(config.match(/"\.md" =>/g)).toHaveLength(1);
+    expect(config).toMatch(/"" => "application\/octet-stream"\n {2}\)$/);
+  });
+
+  it("does not alter the default table", () => {
+    mimeTypesConfig({ html: "text/plain" });
+    expect(mimeTypesConfig()).toContain(
+      '".html" => "text/html; charset=utf-8"',
+    );
+  });
+
+  it("rejects mappings breaking the config syntax", () => {
+    expect(() => mimeTypesConfig({ 'x"y': "text/plain" })).toThrow(
+      "Invalid MIME type mapping",
+    );
+    expect(() => mimeTypesConfig({ x: 'text/"plain"' })).toThrow(
+      "Invalid MIME type mapping",
+    );
+  });
+});
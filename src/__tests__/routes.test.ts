@@ -0,0 +1,97 @@
+import { type Route, routesConfig, routesRegex } from "../routes";
+
+const WEBDAV = 'webdav.activate = "enable"';
+
+function matcher(routes: Route[]): (path: string) => boolean {
+  const regex = new RegExp(routesRegex(routes));
+  return (path) => regex.test(path);
+}
+
+describe("routesRegex()", () => {
+  it("compiles exact and prefix routes", () => {
+    const routes: Route[] = [
+      { config: WEBDAV, match: "exact", path: "/app" },
+      { config: WEBDAV, path: "/api/" },
+    ];
+    expect(routesRegex(routes)).toBe("^/ap(?:p$|i/)");
+
+    const match = matcher(routes);
+    expect(match("/app")).toBe(true);
+    expect(match("/app/")).toBe(false);
+    expect(match("/apple")).toBe(false);
+    expect(match("/api/")).toBe(true);
+    expect(match("/api/v1/users")).toBe(true);
+    expect(match("/api")).toBe(false);
+  });
+
+  it("factors shared prefixes of routes", () => {
+    const routes: Route[] = [
+      { config: WEBDAV, match: "exact", path: "/da" },
+      { config: WEBDAV, path: "/dav/" },
+    ];
+    expect(routesRegex(routes)).toBe("^/da(?:v/|$)");
+
+    const match = matcher(routes);
+    expect(match("/da")).toBe(true);
+    expect(match("/dav/")).toBe(true);
+    expect(match("/dav/file.txt")).toBe(true);
+    expect(match("/dav")).toBe(false);
+    expect(match("/data")).toBe(false);
+  });
+
+  it("drops routes covered by a shorter prefix route", () => {
+    expect(
+      routesRegex([
+        { config: WEBDAV, path: "/dav/" },
+        { config: WEBDAV, path: "/da" },
+      ]),
+    ).toBe("^/da");
+  });
+
+  it("keeps an exact route ending inside other routes", () => {
+    expect(
+      routesRegex([
+        { config: WEBDAV, path: "/api/" },
+        { config: WEBDAV, match: "exact", path: "/app" },
+        { config: WEBDAV, match: "exact", path: "/apple" },
+      ]),
+    ).toBe("^/ap(?:i/|p(?:le$|$))");
+  });
+
+  it("adds regex routes as separate alternatives", () => {
+    const routes: Route[] = [
+      { config: WEBDAV, match: "regex", path: "^/z+" },
+      { config: WEBDAV, match: "exact", path: "/a.b" },
+    ];
+    expect(routesRegex(routes)).toBe("^/a\\.b$|(?:^/z+)");
+
+    const match = matcher(routes);
+    expect(match("/a.b")).toBe(true);
+    expect(match("/axb")).toBe(false);
+    expect(match("/zzz")).toBe(true);
+    expect(routesRegex([routes[0]!])).toBe("(?:^/z+)");
+  });
+
+  it("rejects route paths breaking the config syntax", () => {
+    expect(() => routesRegex([{ config: WEBDAV, path: '/a"b' }])).toThrow(
+      "Route path must not contain double quotes",
+    );
+    expect(() => routesRegex([{ config: WEBDAV, path: "/a\\b" }])).toThrow(
+      "Route path must not contain backslashes",
+    );
+  });
+});
+
+describe("routesConfig()", () => {
+  it("emits a single URL condition per distinct config", () => {
+    const config = routesConfig([
+      { config: WEBDAV, path: "/dav/" },
+      { config: 'expire.url = ("" => "access plus 1 days")', path: "/static/" },
+      { config: WEBDAV, match: "exact", path: "/da" },
+    ]);
+    expect(config.match(/\$HTTP\["url"\]/g)).toHaveLength(2);
+    expect(config).toContain('$HTTP["url"] =~ "^/da(?:v/|$)" {');
+    expect(config).toContain('$HTTP["url"] =~ "^/static/" {');
+    expect(config.indexOf(WEBDAV)).toBeLessThan(config.indexOf("expire.url"));
+  });
+});
@@ -0,0 +1,61 @@
+import { parseConnections, parseCounters } from "../stats";
+
+describe("parseCounters()", () => {
+  it("maps native counters to ServerStats", () => {
+    const json = JSON.stringify({
+      bytesIn: 1200,
+      bytesOut: 34000,
+      latency: [5, 3, 1, 0, 0, 0, 0, 1],
+      requests: 10,
+      statuses: [0, 8, 1, 1, 0],
+      uptime: 42,
+    });
+    expect(parseCounters(json, 1000)).toEqual({
+      bytesIn: 1200,
+      bytesOut: 34000,
+      latency: [5, 3, 1, 0, 0, 0, 0, 1],
+      requests: 10,
+      statuses: { "1xx": 0, "2xx": 8, "3xx": 1, "4xx": 1, "5xx": 0 },
+      timestamp: 1000,
+      uptime: 42,
+    });
+  });
+});
+
+describe("parseConnections()", () => {
+  it("parses the status page, without the status request itself", () => {
+    const text = [
+      "Total Accesses: 12",
+      "Total kBytes: 34",
+      "Uptime: 42",
+      "BusyServers: 4",
+      "IdleServers: 12",
+      "Scoreboard: hkkw____________",
+    ].join("\n");
+    expect(parseConnections(text, 1000)).toEqual({
+      activeConnections: 3,
+      connectionStates: { k: 2, w: 1 },
+      idleConnections: 13,
+      timestamp: 1000,
+    });
+  });
+
+  it("keeps other connections handling requests", () => {
+    const text = "BusyServers: 3\nIdleServers: 1\nScoreboard: hhr_\n";
+    expect(parseConnections(text, 1000)).toEqual({
+      activeConnections: 2,
+      connectionStates: { h: 1, r: 1 },
+      idleConnections: 2,
+      timestamp: 1000,
+    });
+  });
+
+  it("tolerates missing fields", () => {
+    expect(parseConnections("", 1000)).toEqual({
+      activeConnections: 0,
+      connectionStates: {},
+      idleConnections: 0,
+      timestamp: 1000,
+    });
+  });
+});
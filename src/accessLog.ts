@@ -0,0 +1,171 @@
+// Sampled binary access log: its Lighttpd config, and the decoder of its
+// binary export format (documented in host/rnss_accesslog.c).
+
+/**
+ * Options for the sampled binary access log.
+ */
+export type AccessLogOptions = {
+  // Max count of records kept in memory; once it is reached, the oldest
+  // records are overwritten. Defaults 4096 (i.e. 80 KB).
+  capacity?: number;
+
+  // The share of requests recorded into the log, from 0 (exclusive) to 1
+  // (all requests). Defaults 1.
+  sampleRate?: number;
+};
+
+/**
+ * A single access log record.
+ */
+export type AccessLogRecord = {
+  // Response body size (bytes).
+  bytes: number;
+
+  // Cache outcome: "revalidated" for 304 (Not Modified) responses,
+  // "none" otherwise.
+  cache: "none" | "revalidated";
+
+  // Request handling time (microseconds).
+  duration: number;
+
+  // FNV-1a hash of the URL path (see hashPath()).
+  pathHash: number;
+
+  // HTTP status.
+  status: number;
+
+  // Unix time (seconds) of the request.
+  time: number;
+};
+
+/**
+ * Decoded access log export.
+ */
+export type AccessLog = {
+  // The count of sampled records overwritten in the ring, thus lost.
+  overwritten: number;
+
+  // Records, oldest first.
+  records: AccessLogRecord[];
+
+  // The count of requests seen by the log, including not sampled ones.
+  seen: number;
+};
+
+export const ACCESS_LOG_CAPACITY = 4096;
+
+const HEADER_SIZE = 32;
+const MAGIC = "RNSSAL01";
+const RECORD_SIZE = 20;
+
+/**
+ * Returns the FIFO path where Lighttpd writes the access log for the server
+ * with the given config file. NOTE: The native layer derives the same path.
+ * @param configFile
+ */
+export function accessLogFifo(configFile: string): string {
+  return `${configFile}.accesslog`;
+}
+
+/**
+ * Generates Lighttpd config fragment enabling mod_accesslog with a minimal,
+ * numeric line format parsed by the native access log buffer: the request
+ * time, its handling time (us), the response status, body size, the sizes
+ * of the request and the response (with headers), and the URL path.
+ * @param configFile
+ */
+export function accessLogConfig(configFile: string): string {
+  return `server.modules += ("mod_accesslog")
+  accesslog.filename = "${accessLogFifo(configFile)}"
+  accesslog.format = "%{%s}t %{us}T %>s %b %I %O %U"`;
+}
+
+/**
+ * FNV-1a hash of the URL path, as recorded in the access log; it allows
+ * to match records against known paths. The path is expected URL-decoded,
+ * as logged by Lighttpd; NOTE: the native access log buffers decode escape
+ * sequences of mod_accesslog output (e.g. "\xC3\xA9") before hashing
+ * the path, thus both hash the same UTF-8 bytes.
+ * @param path
+ */
+export function hashPath(path: string): number {
+  let hash = 0x811c9dc5;
+  const add = (byte: number) => {
+    hash = Math.imul(hash ^ byte, 0x01000193);
+  };
+  for (const char of path) {
+    const c = char.codePointAt(0)!;
+    if (c < 0x80) add(c);
+    else if (c < 0x800) {
+      add(0xc0 | (c >> 6));
+      add(0x80 | (c & 0x3f));
+    } else if (c < 0x10000) {
+      add(0xe0 | (c >> 12));
+      add(0x80 | ((c >> 6) & 0x3f));
+      add(0x80 | (c & 0x3f));
+    } else {
+      add(0xf0 | (c >> 18));
+      add(0x80 | ((c >> 12) & 0x3f));
+      add(0x80 | ((c >> 6) & 0x3f));
+      add(0x80 | (c & 0x3f));
+    }
+  }
+  return hash >>> 0;
+}
+
+const BASE64 =
+  "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+function decodeBase64(data: string): Uint8Array {
+  const clean = data.replace(/[^A-Za-z0-9+/]/g, "");
+  const res = new Uint8Array(Math.floor((clean.length * 3) / 4));
+  let bits = 0;
+  let value = 0;
+  let pos = 0;
+  for (let i = 0; i < clean.length; ++i) {
+    value = (value << 6) | BASE64.indexOf(clean[i]!);
+    bits += 6;
+    if (bits >= 8) {
+      bits -= 8;
+      res[pos++] = (value >> bits) & 0xff;
+    }
+  }
+  return res;
+}
+
+/**
+ * Decodes a binary access log export, given as a base64 string.
+ * @param data
+ */
+export function decodeAccessLog(data: string): AccessLog {
+  const bytes = decodeBase64(data);
+  const view = new DataView(bytes.buffer, 0, bytes.length);
+  const magic = String.fromCharCode(...bytes.subarray(0, MAGIC.length));
+  if (
+    bytes.length < HEADER_SIZE ||
+    magic !== MAGIC ||
+    view.getUint32(8, true) !== RECORD_SIZE
+  ) {
+    throw Error("Invalid access log data");
+  }
+
+  const count = view.getUint32(12, true);
+  const u64 = (pos: number) =>
+    view.getUint32(pos, true) + 2 ** 32 * view.getUint32(pos + 4, true);
+
+  const records: AccessLogRecord[] = [];
+  for (let i = 0; i < count; ++i) {
+    const pos = HEADER_SIZE + i * RECORD_SIZE;
+    if (pos + RECORD_SIZE > bytes.length) break;
+    records.push({
+      bytes: view.getUint32(pos + 8, true),
+      cache: view.getUint8(pos + 18) ? "revalidated" : "none",
+      duration: view.getUint32(pos + 4, true),
+      pathHash: view.getUint32(pos + 12, true),
+      status: view.getUint16(pos + 16, true),
+      time: view.getUint32(pos, true),
+    });
+  }
+
+  return { overwritten: u64(24), records, seen: u64(16) };
+}
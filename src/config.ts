@@ -1,5 +1,9 @@
 // Encapsulates the standard Lighttpd configuration for the library.
 
+import { accessLogConfig } from "./accessLog";
+import { type MimeTypes, mimeTypesConfig } from "./mimeTypes";
+import { type Route, routesConfig } from "./routes";
+
 import {
   mkdir,
   TemporaryDirectoryPath,
@@ -25,8 +29,17 @@ export const UPLOADS_DIR = `${WORK_DIR}/uploads`;
 /**
  * Options for error log, they mirror debug options of Lighttpd config:
  * https://redmine.lighttpd.net/projects/lighttpd/wiki/DebugVariables
+ * (besides `bufferSize`, which is handled by the native layer).
  */
 export type ErrorLogOptions = {
+  // If set, the log is written to the file asynchronously, via an in-memory
+  // buffer of this size (bytes), see README for details.
+  bufferSize?: number;
+
+  // If set, the log is streamed to JS log listeners, rather than written
+  // to the file.
+  stream?: boolean;
+
   conditionHandling?: boolean;
   fileNotFound?: boolean;
   requestHandling?: boolean;
@@ -43,15 +56,63 @@ export type ErrorLogOptions = {
   timeouts?: boolean;
 };
 
+/**
+ * Device capabilities reported by the native layer (see src/constants.ts);
+ * zero values mean unknown.
+ */
+export type DeviceInfo = {
+  cores: number; // CPU cores.
+  fdLimit: number; // Open file descriptors limit of the app process.
+  ram: number; // Total RAM (bytes).
+};
+
+/**
+ * Connection limits of the server; each of them, if set, overrides the value
+ * derived from the device capabilities.
+ */
+export type ConnectionLimits = {
+  keepAliveIdle?: number; // Seconds.
+  keepAliveRequests?: number;
+  maxConnections?: number;
+  maxFds?: number;
+};
+
 /**
  * Options for the standard Lighttpd configuration for the library.
  */
 export type StandardConfigOptions = {
+  // If set, mod_accesslog is enabled, and it writes per-request records into
+  // the native access log buffer, which keeps the sampled binary access log,
+  // and the request counters for stats (see src/accessLog.ts).
+  accessLog?: boolean;
+
+  device: DeviceInfo;
+
   errorLog?: ErrorLogOptions;
   extraConfig: string;
   fileDir: string;
   hostname: string;
+
+  // If set, the count of concurrent connections is capped to keep
+  // the estimated connection memory of the server within this limit (bytes).
+  memoryLimit?: number;
+
+  // MIME types to add to (or override in) the default table (see
+  // src/mimeTypes.ts).
+  mimeTypes?: MimeTypes;
+
+  limits?: ConnectionLimits;
   port: number;
+  routes?: Route[];
+
+  // If set, requests for missing files are answered with the file at this
+  // URL path (the SPA fallback).
+  spaFallback?: string;
+
+  // If set, mod_status is enabled, and it serves the server status page
+  // at this URL path.
+  statusUrl?: string;
+
   webdav?: string[]; // DEPRECATED
 };
 
@@ -85,36 +146,322 @@ function errorLogConfig(errorLogOptions?: ErrorLogOptions): string {
   return res.join("\n");
 }
 
+/**
+ * Estimated peak memory of a single connection (bytes): its read and write
+ * chunk buffers (8 KB each by default), small files read into memory to be
+ * sent along with response headers, request / response headers, and HTTP/2
+ * stream state.
+ */
+const CONNECTION_MEMORY = 64 << 10;
+
+// NOTE: Lighttpd allocates connection buffers with the general allocator,
+// and the library does not replace it with a dedicated pool; instead, the cap
+// of concurrent connections bounds the total memory of these buffers, and its
+// usage is reported by getConnectionStats() of StaticServer.
+
+// The share of device RAM the server connections may use.
+const RAM_SHARE = 1 / 32;
+
+// The lower bound of derived connection caps, to keep the server usable with
+// HTTP/1.1 clients opening several connections.
+const MIN_CONNECTIONS = 8;
+
+// Devices with less RAM, or CPU cores, than these are considered low-end.
+// NOTE: Not "3 << 30", as JS bit shifts overflow 32-bit integers.
+const LOW_END_RAM = 3 * 2 ** 30;
+const LOW_END_CORES = 4;
+
+// Keep-alive limits for low-end devices, to release connection slots held
+// by idle clients sooner (Lighttpd defaults are 5 seconds, and 1000 requests).
+const LOW_END_KEEP_ALIVE_IDLE = 2;
+const LOW_END_KEEP_ALIVE_REQUESTS = 100;
+
+function maxFds(device: DeviceInfo, limits: ConnectionLimits) {
+  return limits.maxFds ?? (Math.floor(device.fdLimit / 2) || undefined);
+}
+
+/**
+ * Returns server.max-connections value for the device, the limits, and
+ * the memory limit (see connectionsConfig()); undefined if it is left to
+ * Lighttpd default.
+ * @param device
+ * @param limits
+ * @param memoryLimit Memory limit (bytes).
+ */
+export function maxConnections(
+  device: DeviceInfo,
+  limits: ConnectionLimits,
+  memoryLimit: number | undefined,
+): number | undefined {
+  if (limits.maxConnections !== undefined) return limits.maxConnections;
+
+  const caps: number[] = [];
+  const fds = maxFds(device, limits);
+  if (fds) caps.push(fds / 2);
+  if (device.ram) caps.push((RAM_SHARE * device.ram) / CONNECTION_MEMORY);
+  if (memoryLimit) caps.push(memoryLimit / CONNECTION_MEMORY);
+  if (!caps.length) return undefined;
+  return Math.max(MIN_CONNECTIONS, Math.floor(Math.min(...caps)));
+}
+
+/**
+ * Generates the config fragment with connection limits of the server, derived
+ * from the device capabilities, and the memory limit, if any:
+ * - server.max-fds - Half of the process limit, as the server shares it with
+ *   the rest of the app;
+ * - server.max-connections - Half of max-fds (a socket, and an open file per
+ *   connection), but no more connections than their estimated memory fits
+ *   into the share of RAM, or into the memory limit. Once the cap is reached,
+ *   Lighttpd stops accepting new connections until some of the open ones are
+ *   closed, thus new clients wait in the listen backlog, rather than grow
+ *   the server memory, or exhaust the descriptors;
+ * - server.max-keep-alive-idle, and server.max-keep-alive-requests - Reduced
+ *   on low-end devices, Lighttpd defaults otherwise.
+ *
+ * Values unknown for the device are left to Lighttpd defaults; directives
+ * set by the extra config are skipped, as Lighttpd rejects duplicate
+ * assignments.
+ *
+ * NOTE: host/standard_config.c mirrors this function.
+ * @param device
+ * @param limits
+ * @param memoryLimit Memory limit (bytes).
+ * @param extraConfig
+ */
+export function connectionsConfig(
+  device: DeviceInfo,
+  limits: ConnectionLimits,
+  memoryLimit: number | undefined,
+  extraConfig: string,
+): string {
+  const lowEnd =
+    (!!device.ram && device.ram < LOW_END_RAM) ||
+    (!!device.cores && device.cores <= LOW_END_CORES);
+
+  const values: Array<[string, number | undefined]> = [
+    ["server.max-fds", maxFds(device, limits)],
+    ["server.max-connections", maxConnections(device, limits, memoryLimit)],
+    [
+      "server.max-keep-alive-idle",
+      limits.keepAliveIdle ?? (lowEnd ? LOW_END_KEEP_ALIVE_IDLE : undefined),
+    ],
+    [
+      "server.max-keep-alive-requests",
+      limits.keepAliveRequests ??
+        (lowEnd ? LOW_END_KEEP_ALIVE_REQUESTS : undefined),
+    ],
+  ];
+
+  return values
+    .filter(
+      ([key, value]) => value !== undefined && !extraConfig.includes(key),
+    )
+    .map(([key, value]) => `${key} = ${value}`)
+    .join("\n");
+}
+
+/**
+ * Lighttpd modules pre-built with the library (PLUGIN_STATIC list in
+ * CMakeLists.txt), in their loading order, along with the prefixes of config
+ * directives handled by them, including their legacy spellings.
+ * NOTE: mod_staticfile is always loaded, and it must be the last of request
+ * handlers, thus only mod_accesslog follows it.
+ */
+const MODULES: Array<[string, string[]]> = [
+  ["mod_h2", []],
+  ["mod_rewrite", ["url.rewrite"]],
+  ["mod_redirect", ["url.redirect"]],
+  ["mod_alias", ["alias.url"]],
+  ["mod_access", ["url.access-"]],
+  ["mod_setenv", ["setenv."]],
+  ["mod_evhost", ["evhost."]],
+  ["mod_simple_vhost", ["simple-vhost."]],
+  ["mod_expire", ["expire."]],
+  ["mod_fastcgi", ["fastcgi."]],
+  ["mod_scgi", ["scgi."]],
+  ["mod_webdav", ["webdav."]],
+  ["mod_status", ["status."]],
+  ["mod_indexfile", ["index-file.", "server.indexfiles"]],
+  ["mod_dirlisting", ["dir-listing.", "server.dir-listing"]],
+  ["mod_staticfile", ["static-file."]],
+  ["mod_accesslog", ["accesslog."]],
+];
+
+const ALWAYS_LOADED_MODULES = ["mod_h2", "mod_staticfile"];
+
+/**
+ * Prefixes of config directives handled by Lighttpd core, and of config
+ * variables.
+ */
+const CORE_PREFIXES = [
+  "connection.",
+  "debug.",
+  "env.",
+  "etag.",
+  "mimetype.",
+  "server.",
+  "var.",
+];
+
+/**
+ * Matches directive assignments (e.g. `key.name = value`, or `+=`, `:=`)
+ * in a config, capturing the directive keys.
+ */
+const DIRECTIVE_REGEX = /(?:^|[\s{])([a-z][\w-]*(?:\.[\w-]+)+)\s*[+:]?=(?![=~>])/gm;
+
+/**
+ * Returns true if the config has any directive not recognized as a core
+ * directive, or a directive of a module pre-built with the library.
+ * @param config
+ */
+function hasUnknownDirectives(config: string): boolean {
+  for (const match of config.matchAll(DIRECTIVE_REGEX)) {
+    const key = match[1]!;
+    const known =
+      CORE_PREFIXES.some((prefix) => key.startsWith(prefix)) ||
+      MODULES.some(([, prefixes]) =>
+        prefixes.some((prefix) => key.startsWith(prefix)),
+      );
+    if (!known) return true;
+  }
+  return false;
+}
+
+/**
+ * Generates the config fragment which explicitly lists the modules used by
+ * the given config, and disables Lighttpd's automatic loading of default
+ * modules; thus, Lighttpd initializes, and runs per-request hooks of, only
+ * the modules the config actually needs. A module is considered used if it is
+ * named anywhere in the config (e.g. in its own `server.modules += (...)`
+ * statement), or if any of its directives is present; the resulting list
+ * replaces (:=) any `server.modules` set before. However, if the config has
+ * any directive we do not recognize, the automatic loading of default modules
+ * is kept enabled, as such directive might need one of them.
+ *
+ * NOTE: host/standard_config.c mirrors this function.
+ * @param config
+ */
+export function modulesConfig(config: string): string {
+  const used = (name: string, prefixes: string[]) =>
+    ALWAYS_LOADED_MODULES.includes(name) ||
+    config.includes(`"${name}"`) ||
+    prefixes.some((prefix) => config.includes(prefix));
+
+  const modules: string[] = [];
+  for (const [name, prefixes] of MODULES) {
+    // Modules not pre-built with the library (thus, unknown to us), but named
+    // in the config are kept, in front of the default request handlers.
+    if (name === "mod_indexfile") {
+      for (const match of config.matchAll(/"(mod_\w+)"/g)) {
+        const other = match[1]!;
+        const known = MODULES.some(([it]) => it === other);
+        if (!known && !modules.includes(other)) modules.push(other);
+      }
+    }
+    if (used(name, prefixes)) modules.push(name);
+  }
+
+  let res = `server.modules := (${modules.map((it) => `"${it}"`).join(", ")})`;
+  if (!hasUnknownDirectives(config)) {
+    res += `\n  server.compat-module-load = "disable"`;
+  }
+  return res;
+}
+
+/**
+ * Regex matching URL paths with a file extension in their last segment, i.e.
+ * the paths of assets, rather than client-side routes of single-page apps.
+ */
+export const ASSET_PATH_REGEX = "\\.[^/]*$";
+
+/**
+ * Generates the config fragment answering requests for missing files at
+ * extensionless URL paths (client-side routes of a single-page app) with
+ * the given entry file. Requests for missing assets (e.g. "/main.js") still
+ * get 404 responses, thus asset load failures are detectable, and not cached
+ * as the entry file content.
+ *
+ * NOTE: The 404 handler runs only for missing files, thus besides a single
+ * regex match per request it costs nothing for requests to existing files,
+ * unlike mod_rewrite rules (an extra file lookup for rewritten requests).
+ * @param path URL path of the entry file.
+ */
+export function spaFallbackConfig(path: string): string {
+  return `$HTTP["url"] !~ "${ASSET_PATH_REGEX}" {
+    server.error-handler-404 = "${path}"
+  }`;
+}
+
 /**
  * Generates the standard Lighttpd config.
- * @param param0
+ *
+ * NOTE: host/standard_config.c mirrors this function for the standalone
+ * Linux host build of the server, keep them in sync.
+ * @param configFile Path of the config file being generated.
+ * @param param1
  * @returns
  */
-function standardConfig({
-  errorLog,
-  extraConfig,
-  fileDir,
-  hostname,
-  port,
-  webdav, // DEPRECATED
-}: StandardConfigOptions) {
+function standardConfig(
+  configFile: string,
+  {
+    accessLog,
+    device,
+    errorLog,
+    extraConfig,
+    fileDir,
+    hostname,
+    limits = {},
+    memoryLimit,
+    mimeTypes,
+    port,
+    routes,
+    spaFallback,
+    statusUrl,
+    webdav, // DEPRECATED
+  }: StandardConfigOptions,
+) {
+  const spaConfig = spaFallback ? spaFallbackConfig(spaFallback) : "";
+
+  let statusConfig = "";
+  if (statusUrl) {
+    statusConfig = `server.modules += ("mod_status")
+    status.status-url = "${statusUrl}"`;
+  }
+
+  // NOTE: All WebDAV routes are matched by a single condition, thus a single
+  // regex match per request, rather than one per route.
   let webdavConfig = "";
-  if (webdav) {
-    webdavConfig += 'server.modules += ("mod_webdav")';
-    for (let i = 0; i < webdav.length; ++i) {
-      webdavConfig += `$HTTP["url"] =~ "${webdav[i]}" { webdav.activate = "enable" }`;
-    }
+  if (webdav?.length) {
+    const routes = webdav.map((route) => `(?:${route})`).join("|");
+    webdavConfig = `server.modules += ("mod_webdav")
+    $HTTP["url"] =~ "${routes}" { webdav.activate = "enable" }`;
+  }
+
+  // NOTE: Lighttpd rejects duplicate assignment of the same config variable,
+  // thus the table is not generated if the extra config sets it on its own.
+  let mimeConfig = "";
+  if (!extraConfig.includes("mimetype.assign")) {
+    mimeConfig = mimeTypesConfig(mimeTypes);
   }
 
-  return `server.document-root = "${fileDir}"
+  const config = `server.document-root = "${fileDir}"
   server.bind = "${hostname}"
   server.upload-dirs = ( "${UPLOADS_DIR}" )
   server.port = ${port}
   ${errorLogConfig(errorLog)}
   index-file.names += ("index.xhtml", "index.html", "index.htm", "default.htm", "index.php")
+  ${mimeConfig}
+  ${connectionsConfig(device, limits, memoryLimit, extraConfig)}
 
+  ${accessLog ? accessLogConfig(configFile) : ""}
+  ${spaConfig}
+  ${statusConfig}
   ${webdavConfig}
+  ${routes ? routesConfig(routes) : ""}
   ${extraConfig}`;
+
+  return `${config}
+  ${modulesConfig(config)}`;
 }
 
 /**
@@ -133,6 +480,6 @@ export async function newStandardConfigFile(
   await mkdir(UPLOADS_DIR);
 
   const configFile = `${WORK_DIR}/config-${Date.now()}.txt`;
-  await writeFile(configFile, standardConfig(options), "utf8");
+  await writeFile(configFile, standardConfig(configFile, options), "utf8");
   return configFile;
 }
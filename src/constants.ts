@@ -1,15 +1,23 @@
 // Imports internal constants defined within the native layer,
 // and exports user-facing constants for server states.
 
+import type { DeviceInfo } from "./config";
 import ReactNativeStaticServer from "./NativeReactNativeStaticServer";
 
 const CONSTANTS = ReactNativeStaticServer.getConstants();
 
 export const IS_MAC_CATALYST = CONSTANTS.IS_MAC_CATALYST;
 
+export const DEVICE_INFO: DeviceInfo = {
+  cores: CONSTANTS.DEVICE_CORES,
+  fdLimit: CONSTANTS.DEVICE_FD_LIMIT,
+  ram: CONSTANTS.DEVICE_RAM,
+};
+
 export const SIGNALS = {
   CRASHED: CONSTANTS.CRASHED,
   LAUNCHED: CONSTANTS.LAUNCHED,
+  LOG: CONSTANTS.LOG,
   TERMINATED: CONSTANTS.TERMINATED,
 };
 
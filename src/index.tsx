@@ -11,24 +11,63 @@ import {
   DocumentDirectoryPath,
   mkdir,
   readDirAssets,
+  readFile,
   unlink,
 } from "@dr.pogodin/react-native-fs";
 
 import { Emitter, Semaphore } from "@dr.pogodin/js-utils";
 
+import {
+  ACCESS_LOG_CAPACITY,
+  decodeAccessLog,
+  hashPath,
+  type AccessLog,
+  type AccessLogOptions,
+  type AccessLogRecord,
+} from "./accessLog";
+
 import {
   ERROR_LOG_FILE,
+  maxConnections,
   newStandardConfigFile,
+  WORK_DIR,
+  type ConnectionLimits,
+  type DeviceInfo,
   type ErrorLogOptions,
 } from "./config";
 
-import { SIGNALS, STATES } from "./constants";
+import { DEVICE_INFO, SIGNALS, STATES } from "./constants";
+import type { MimeTypes } from "./mimeTypes";
 import ReactNativeStaticServer from "./NativeReactNativeStaticServer";
+import type { Route } from "./routes";
+import {
+  LATENCY_BOUNDS,
+  parseConnections,
+  parseCounters,
+  statusUrl,
+  type ConnectionStats,
+  type ServerStats,
+} from "./stats";
 import { resolveAssetsPath } from "./utils";
 
 export { ERROR_LOG_FILE, UPLOADS_DIR, WORK_DIR } from "./config";
 
-export { STATES, resolveAssetsPath };
+export {
+  DEVICE_INFO,
+  LATENCY_BOUNDS,
+  STATES,
+  hashPath,
+  resolveAssetsPath,
+  type AccessLog,
+  type AccessLogOptions,
+  type AccessLogRecord,
+  type ConnectionLimits,
+  type ConnectionStats,
+  type DeviceInfo,
+  type MimeTypes,
+  type Route,
+  type ServerStats,
+};
 
 // ID-to-StaticServer map for all potentially active server instances,
 // used to route native events back to JS server objects.
@@ -38,18 +77,87 @@ const nativeEventEmitter = new NativeEventEmitter(ReactNativeStaticServer);
 
 const LOOPBACK_ADDRESS = "127.0.0.1";
 
+// The default URL path of the SPA fallback file.
+const SPA_FALLBACK_INDEX = "/index.html";
+
+// The default size of the native log buffer for the streamed error log.
+const LOG_STREAM_BUFFER_SIZE = 65536;
+
+export type LogListener = (lines: string) => void;
+
+/**
+ * Scheduling options of the native server thread.
+ */
+export type ThreadOptions = {
+  // Windows only. If set, the server thread is restricted to the performance
+  // cores of hybrid CPUs. On iOS the core type is driven by the priority
+  // (QoS class), and on Android it is not supported, thus ignored.
+  bigCores?: boolean;
+
+  // "interactive" - for serving content the app UI waits for (QoS class
+  // User Interactive on iOS, display thread priority on Android, above normal
+  // priority on Windows); "utility" - for background serving (QoS class
+  // Utility, background priority, below normal priority); "default" (the
+  // default) - the platform default priority.
+  priority?: "default" | "interactive" | "utility";
+};
+
 export type StateListener = (
   newState: STATES,
   details: string,
   error?: Error,
 ) => void;
 
+/**
+ * Durations (ms) of the server launch phases, measured by the last successful
+ * .start() call of a server instance. The native layer measures its phases
+ * on a monotonic clock, and reports them along with the LAUNCHED signal;
+ * the native fields are undefined if the native layer did not report them.
+ */
+export type LaunchTimings = {
+  // JS <-> native communication overhead: the time from the native start()
+  // call till its resolution in JS, minus the time accounted by the native
+  // layer from the native start() call till LAUNCHED callback.
+  bridge?: number;
+
+  // Generation of the config file.
+  configWrite: number;
+
+  // From the native lighttpd_launch() call till LAUNCHED callback,
+  // i.e. config reading & parsing, plugins initialization, socket binding,
+  // and the event loop entry.
+  launch?: number;
+
+  // From .start() call till the native start() call: hostname & port
+  // selection (at the first launch), and config file generation.
+  prepare: number;
+
+  // From the native start() call till the server thread start.
+  threadStart?: number;
+
+  // From .start() call till the server becoming ACTIVE.
+  total: number;
+};
+
 nativeEventEmitter.addListener(
   "RNStaticServer",
   ({ serverId, event, details }) => {
     const group = servers[serverId];
     if (group) {
       switch (event) {
+        case SIGNALS.LAUNCHED:
+          // NOTE: The native layer emits it only for a server launched
+          // outside of .start() calls, i.e. an autostarted server adopted
+          // by instances created with STARTING state.
+          group.forEach((item) => {
+            if (item._state === STATES.STARTING) {
+              item._setState(STATES.ACTIVE);
+            }
+          });
+          break;
+        case SIGNALS.LOG:
+          group.forEach((item) => item._logEmitter.emit(details));
+          break;
         case SIGNALS.CRASHED:
           // TODO: We probably can, and should, capture the native stack trace
           // and pass it along with the error.
@@ -84,21 +192,35 @@ class StaticServer {
   // Babel's @babel/plugin-proposal-private-methods causes many troubles in RN.
   // See: https://github.com/birdofpreyru/react-native-static-server/issues/6
   // and: https://github.com/birdofpreyru/react-native-static-server/issues/9
+  _accessLog?: AccessLogOptions;
   _appStateSub?: NativeEventSubscription;
   _configPath?: string;
   _errorLog?: ErrorLogOptions;
   _extraConfig: string;
   _fileDir: string;
   _hostname = "";
+  _launchTimings?: LaunchTimings;
+  _limits: ConnectionLimits;
+  _logEmitter = new Emitter<[string]>();
+  _maxConnections?: number;
+  _memoryLimit?: number;
+  _mimeTypes?: MimeTypes;
 
   /* DEPRECATED */ _nonLocal: boolean;
 
   _origin: string = "";
   _stopInBackground: boolean;
   _port: number;
+  _routes?: Route[];
+  _spaFallback?: string;
 
   _state: STATES;
+  _statsEnabled: boolean;
+  _stats?: ServerStats;
+  _statsPromise?: Promise<ServerStats>;
+  _statusUrl?: string;
   _stateChangeEmitter = new Emitter<[STATES, string, Error | undefined]>();
+  _thread: ThreadOptions;
 
   // TODO: It will be better to use UUID, but I believe "uuid" library
   // I would use won't work in RN without additional workarounds applied
@@ -113,6 +235,10 @@ class StaticServer {
 
   _webdav: string[] | undefined;
 
+  get accessLog(): false | AccessLogOptions {
+    return this._accessLog || false;
+  }
+
   get errorLog(): false | ErrorLogOptions {
     return this._errorLog || false;
   }
@@ -129,6 +255,22 @@ class StaticServer {
     return this._id;
   }
 
+  get launchTimings() {
+    return this._launchTimings;
+  }
+
+  get limits(): ConnectionLimits {
+    return this._limits;
+  }
+
+  get memoryLimit(): number | undefined {
+    return this._memoryLimit;
+  }
+
+  get mimeTypes(): MimeTypes {
+    return this._mimeTypes || {};
+  }
+
   /** @deprecated */
   get nonLocal() {
     return this._nonLocal;
@@ -146,10 +288,26 @@ class StaticServer {
     return this._port;
   }
 
+  get stats() {
+    return this._statsEnabled;
+  }
+
+  get routes(): Route[] {
+    return this._routes || [];
+  }
+
+  get spaFallback(): false | string {
+    return this._spaFallback || false;
+  }
+
   get state() {
     return this._state;
   }
 
+  get thread(): ThreadOptions {
+    return this._thread;
+  }
+
   _setState(neu: STATES, details: string = "", error?: Error) {
     this._state = neu;
     this._stateChangeEmitter.emit(neu, details, error);
@@ -159,6 +317,7 @@ class StaticServer {
    * Creates a new Server instance.
    */
   constructor({
+    accessLog,
     errorLog = false,
     extraConfig = "",
     fileDir,
@@ -171,40 +330,91 @@ class StaticServer {
     // See: https://github.com/microsoft/react-native-windows/issues/11322
     id = Date.now() % 65535,
 
+    limits = {},
+    memoryLimit,
+    mimeTypes,
+
     /* DEPRECATED */ nonLocal = false,
 
     port = 0,
+    routes,
+    spaFallback,
     state = STATES.INACTIVE,
+    stats = false,
     stopInBackground = false,
+    thread = {},
 
     /* DEPRECATED */ webdav,
   }: {
+    accessLog?: boolean | AccessLogOptions;
     extraConfig?: string;
     errorLog?: boolean | ErrorLogOptions;
     fileDir: string;
     hostname?: string;
     id?: number;
+    limits?: ConnectionLimits;
+    memoryLimit?: number;
+    mimeTypes?: MimeTypes;
 
     /* DEPRECATED */ nonLocal?: boolean;
 
     port?: number;
+    routes?: Route[];
+    spaFallback?: boolean | string;
     state?: STATES;
+    stats?: boolean;
     stopInBackground?: boolean;
+    thread?: ThreadOptions;
 
     /* DEPRECATED */ webdav?: string[];
   }) {
+    if (accessLog) {
+      // NOTE: mod_accesslog DLL is not pre-built for Windows, and the native
+      // access log buffer is not implemented there yet.
+      if (Platform.OS === "windows") {
+        throw Error("`accessLog` option is not supported on Windows yet");
+      }
+      this._accessLog = accessLog === true ? {} : accessLog;
+      const rate = this._accessLog.sampleRate;
+      if (rate !== undefined && !(rate > 0 && rate <= 1)) {
+        throw Error("`accessLog.sampleRate` must be in (0; 1] range");
+      }
+    }
+
     if (errorLog) this._errorLog = errorLog === true ? {} : errorLog;
+    if (this._errorLog?.stream && Platform.OS === "windows") {
+      throw Error("`errorLog.stream` option is not supported on Windows yet");
+    }
 
     this._extraConfig = extraConfig;
     this._id = id;
+    if (memoryLimit !== undefined && !(memoryLimit > 0)) {
+      throw Error("`memoryLimit` must be a positive number");
+    }
+    this._limits = limits;
+    this._memoryLimit = memoryLimit;
+    this._mimeTypes = mimeTypes;
 
     this._nonLocal = nonLocal;
     this._hostname = hostname || (nonLocal ? "" : LOOPBACK_ADDRESS);
 
     this._port = port;
+    this._routes = routes;
+    if (spaFallback) {
+      this._spaFallback =
+        spaFallback === true ? SPA_FALLBACK_INDEX : spaFallback;
+    }
     this._stopInBackground = stopInBackground;
 
+    // NOTE: mod_status DLL is not pre-built for Windows, and the native
+    // request counters are not implemented there yet.
+    if (stats && Platform.OS === "windows") {
+      throw Error("`stats` option is not supported on Windows yet");
+    }
+    this._statsEnabled = stats;
+
     this._state = state;
+    this._thread = thread;
 
     // NOTE: Normally, a server instance is connected to events from the native
     // side inside its .start() call, and it is disconnected from them inside
@@ -215,6 +425,9 @@ class StaticServer {
       case STATES.ACTIVE:
       case STATES.STARTING: {
         this._registerSelf();
+        if (this._hostname && port) {
+          this._origin = `http://${this._hostname}:${port}`;
+        }
         break;
       }
       default:
@@ -226,6 +439,16 @@ class StaticServer {
     this._webdav = webdav;
   }
 
+  /**
+   * Adds a listener of the server log, streamed with `errorLog.stream` option.
+   * The listener is called with batches of new log lines.
+   * @param listener
+   * @returns Unsubscribe function.
+   */
+  addLogListener(listener: LogListener) {
+    return this._logEmitter.addListener(listener);
+  }
+
   addStateListener(listener: StateListener) {
     return this._stateChangeEmitter.addListener(listener);
   }
@@ -284,6 +507,114 @@ class StaticServer {
     }
   }
 
+  /**
+   * Writes the sampled access log of the server into a file, in the binary
+   * format (see host/rnss_accesslog.c for its decoder). The server must be
+   * created with `accessLog` option, and be ACTIVE.
+   * @param path
+   * @returns Resolves to the count of written records.
+   */
+  async exportAccessLog(path: string): Promise<number> {
+    if (!this._accessLog) {
+      throw Error("The server was not created with `accessLog` option");
+    }
+    if (this._state !== STATES.ACTIVE) {
+      throw Error(`Server is not active (state ${this._state})`);
+    }
+    return ReactNativeStaticServer.exportAccessLog(path);
+  }
+
+  /**
+   * Exports the sampled access log of the server, and decodes it.
+   * The server must be created with `accessLog` option, and be ACTIVE.
+   * @returns {Promise<AccessLog>}
+   */
+  async getAccessLog(): Promise<AccessLog> {
+    const path = `${WORK_DIR}/accesslog-${Date.now()}.bin`;
+    await this.exportAccessLog(path);
+    try {
+      return decodeAccessLog(await readFile(path, "base64"));
+    } finally {
+      await unlink(path);
+    }
+  }
+
+  /**
+   * Fetches the current connection stats from mod_status page of the server.
+   * The server must be created with `stats` option, be ACTIVE, and be
+   * launched by .start() of this instance.
+   * @returns {Promise<ConnectionStats>}
+   */
+  async getConnectionStats(): Promise<ConnectionStats> {
+    this._assertStatsAvailable();
+    return {
+      ...parseConnections(await this._fetchStatusPage(), Date.now()),
+      maxConnections: this._maxConnections,
+    };
+  }
+
+  /**
+   * Gets the current server request counters. They are kept by the native
+   * layer, thus no request to the server is made.
+   * The server must be created with `stats` option, and be ACTIVE.
+   *
+   * Concurrent calls share a single in-flight request.
+   * @param {number} [maxAge=0] Optional. Max age (ms) of a previously taken
+   *  snapshot, which may be returned instead of taking a new one.
+   * @returns {Promise<ServerStats>}
+   */
+  async getStats(maxAge: number = 0): Promise<ServerStats> {
+    this._assertStatsAvailable(true);
+    if (this._stats && Date.now() - this._stats.timestamp <= maxAge) {
+      return this._stats;
+    }
+    if (!this._statsPromise) {
+      this._statsPromise = this._fetchStats().finally(() => {
+        this._statsPromise = undefined;
+      });
+    }
+    return this._statsPromise;
+  }
+
+  /**
+   * Throws if the server stats are not available.
+   * @param nativeOnly Optional. If set, the status page is not required.
+   */
+  _assertStatsAvailable(nativeOnly?: boolean) {
+    if (!this._statsEnabled) {
+      throw Error("The server was not created with `stats` option");
+    }
+    if (this._state !== STATES.ACTIVE) {
+      throw Error(`Server is not active (state ${this._state})`);
+    }
+    if (!nativeOnly && !this._statusUrl) {
+      // NOTE: The status page URL is generated by .start(), thus it is unknown
+      // for a server launched otherwise (e.g. an adopted autostarted one).
+      throw Error("The server was not launched by .start() of this instance");
+    }
+  }
+
+  async _fetchStats(): Promise<ServerStats> {
+    const json = await ReactNativeStaticServer.getStats();
+    this._stats = parseCounters(json, Date.now());
+    return this._stats;
+  }
+
+  async _fetchStatusPage(): Promise<string> {
+    const res = await fetch(`${this._origin}${this._statusUrl}?auto`);
+    if (!res.ok) throw Error(`Failed to fetch server stats: ${res.status}`);
+    return res.text();
+  }
+
+  /**
+   * Removes given log listener, if it is connected to this server instance;
+   * or does nothing if the listener is not connected to it.
+   * @param listener
+   */
+  removeLogListener(listener: LogListener) {
+    this._logEmitter.removeListener(listener);
+  }
+
   /**
    * Removes all state listeners connected to this server instance.
    */
@@ -311,6 +642,7 @@ class StaticServer {
       this._stableStateGuard();
       if (this._state === STATES.ACTIVE) return this._origin!;
 
+      const startedAt = Date.now();
       this._registerSelf();
       this._setState(STATES.STARTING, details);
       this._configureAppStateHandling();
@@ -325,24 +657,80 @@ class StaticServer {
         this._port = await ReactNativeStaticServer.getOpenPort(this._hostname);
       }
       this._origin = `http://${this._hostname}:${this._port}`;
+      if (this._statsEnabled && !this._statusUrl) {
+        const token = await ReactNativeStaticServer.getRandomToken();
+        this._statusUrl = statusUrl(token);
+      }
+
+      // NOTE: Native request counters are kept by the access log buffer.
+      const counters = this._statsEnabled;
+
+      // NOTE: The extra config may set the connections cap on its own.
+      let cap = maxConnections(DEVICE_INFO, this._limits, this._memoryLimit);
+      if (this._extraConfig.includes("server.max-connections")) {
+        const match = /server\.max-connections\s*=\s*(\d+)/.exec(
+          this._extraConfig,
+        );
+        cap = match ? Number(match[1]) : undefined;
+      }
+      this._maxConnections = cap;
 
       await this._removeConfigFile();
+      const configAt = Date.now();
       this._configPath = await newStandardConfigFile({
+        accessLog: !!this._accessLog || counters,
+        device: DEVICE_INFO,
         errorLog: this._errorLog,
         extraConfig: this._extraConfig,
         fileDir: this._fileDir,
         hostname: this._hostname,
+        limits: this._limits,
+        memoryLimit: this._memoryLimit,
+        mimeTypes: this._mimeTypes,
         port: this._port,
+        routes: this._routes,
+        spaFallback: this._spaFallback,
+        statusUrl: this._statusUrl,
         webdav: this._webdav,
       });
 
+      let errlogPath = "";
+      let errlogBufferSize = this._errorLog?.bufferSize || 0;
+      if (this._errorLog?.stream) {
+        errlogBufferSize ||= LOG_STREAM_BUFFER_SIZE;
+      } else if (this._errorLog) errlogPath = ERROR_LOG_FILE;
+
       // Native implementations of .start() method must resolve only once
-      // the server has been launched (ready to handle incoming requests).
-      await ReactNativeStaticServer.start(
+      // the server has been launched (ready to handle incoming requests),
+      // and they resolve to the JSON with durations of native launch phases.
+      const nativeAt = Date.now();
+      const details = await ReactNativeStaticServer.start(
         this._id,
         this._configPath,
-        this._errorLog ? ERROR_LOG_FILE : "",
+        errlogPath,
+        errlogBufferSize,
+        this._accessLog ? this._accessLog.capacity || ACCESS_LOG_CAPACITY : 0,
+        this._accessLog?.sampleRate || 1,
+        counters,
+        this._thread.priority || "default",
+        !!this._thread.bigCores,
       );
+      const launchedAt = Date.now();
+      this._stats = undefined;
+
+      this._launchTimings = {
+        configWrite: nativeAt - configAt,
+        prepare: nativeAt - startedAt,
+        total: launchedAt - startedAt,
+      };
+      try {
+        const native = JSON.parse(details);
+        this._launchTimings.bridge = launchedAt - nativeAt - native.launched;
+        this._launchTimings.launch = native.launched - native.launchCall;
+        this._launchTimings.threadStart = native.threadStart;
+      } catch {
+        // NOOP: The native layer did not report launch timings.
+      }
 
       this._setState(STATES.ACTIVE);
       this._removeConfigFile();
@@ -444,6 +832,16 @@ class StaticServer {
 
 export default StaticServer;
 
+/**
+ * Writes the server trace (see host/trace.h) into a new file inside WORK_DIR,
+ * and resolves to its path. It is supported only by Android builds with
+ * WITH_RNSS_TRACE option.
+ * @return {Promise<string>}
+ */
+export function dumpTrace(): Promise<string> {
+  return ReactNativeStaticServer.dumpTrace(WORK_DIR);
+}
+
 /**
  * Extracts bundled assets into the specified regular directory,
  * preserving asset folder structure, and overwriting any conflicting files
@@ -0,0 +1,96 @@
+// MIME types of the files served by the server, by file extension, with
+// the charset already applied to text types; and the generator of
+// the corresponding Lighttpd config fragment.
+//
+// NOTE: host/CMakeLists.txt generates the C table for host builds from this
+// file, at build time, by parsing MIME_TYPES entries line by line; thus keep
+// them one per line, in the `  ext: "type",` format.
+
+/**
+ * MIME types by file extension (without the leading dot), e.g.
+ * { md: "text/markdown; charset=utf-8" }.
+ */
+export type MimeTypes = { [extension: string]: string };
+
+// The type of files with extensions not listed below.
+const DEFAULT_TYPE = "application/octet-stream";
+
+const MIME_TYPES: MimeTypes = {
+  aac: "audio/aac",
+  avif: "image/avif",
+  bmp: "image/bmp",
+  css: "text/css; charset=utf-8",
+  csv: "text/csv; charset=utf-8",
+  eot: "application/vnd.ms-fontobject",
+  epub: "application/epub+zip",
+  flac: "audio/flac",
+  gif: "image/gif",
+  gz: "application/gzip",
+  htm: "text/html; charset=utf-8",
+  html: "text/html; charset=utf-8",
+  ico: "image/x-icon",
+  jpeg: "image/jpeg",
+  jpg: "image/jpeg",
+  js: "text/javascript; charset=utf-8",
+  json: "application/json; charset=utf-8",
+  m4a: "audio/mp4",
+  m4v: "video/mp4",
+  map: "application/json; charset=utf-8",
+  md: "text/markdown; charset=utf-8",
+  mjs: "text/javascript; charset=utf-8",
+  mov: "video/quicktime",
+  mp3: "audio/mpeg",
+  mp4: "video/mp4",
+  oga: "audio/ogg",
+  ogg: "audio/ogg",
+  ogv: "video/ogg",
+  otf: "font/otf",
+  pdf: "application/pdf",
+  png: "image/png",
+  svg: "image/svg+xml; charset=utf-8",
+  ttf: "font/ttf",
+  txt: "text/plain; charset=utf-8",
+  vtt: "text/vtt; charset=utf-8",
+  wasm: "application/wasm",
+  wav: "audio/wav",
+  webm: "video/webm",
+  webmanifest: "application/manifest+json; charset=utf-8",
+  webp: "image/webp",
+  woff: "font/woff",
+  woff2: "font/woff2",
+  xhtml: "application/xhtml+xml; charset=utf-8",
+  xml: "application/xml; charset=utf-8",
+  zip: "application/zip",
+};
+
+function assignments(types: MimeTypes): string[] {
+  return Object.entries(types).map(([ext, type]) => {
+    if (!/^[\w.+-]+$/.test(ext) || type.includes('"')) {
+      throw Error(`Invalid MIME type mapping: ${ext} => ${type}`);
+    }
+    return `".${ext}" => "${type}"`;
+  });
+}
+
+// The config fragment for the default table, which does not change,
+// thus it is generated once.
+let defaultConfig: string | undefined;
+
+/**
+ * Generates Lighttpd config fragment assigning MIME types to the served files
+ * by their extensions, according to the default table, extended (or
+ * overridden) by the given types.
+ * @param extraTypes
+ */
+export function mimeTypesConfig(extraTypes?: MimeTypes): string {
+  if (!extraTypes && defaultConfig) return defaultConfig;
+
+  const types = extraTypes ? { ...MIME_TYPES, ...extraTypes } : MIME_TYPES;
+  const res = `mimetype.assign = (
+    ${assignments(types).join(",\n    ")},
+    "" => "${DEFAULT_TYPE}"
+  )`;
+
+  if (!extraTypes) defaultConfig = res;
+  return res;
+}
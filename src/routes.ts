@@ -0,0 +1,119 @@
+// Structured routes: Lighttpd config directives applied to requests matched
+// by URL path, compiled into the minimal set of regex conditions.
+
+/**
+ * A route of the server.
+ */
+export type Route = {
+  // Lighttpd config directives applied to the requests matched by the route,
+  // e.g. 'webdav.activate = "enable"'.
+  config: string;
+
+  // How the path is matched against URL paths of requests:
+  // - "exact" - the URL path is equal to the route path;
+  // - "prefix" (default) - the URL path starts with the route path;
+  // - "regex" - the route path is a PCRE regex, matched against the URL path.
+  match?: "exact" | "prefix" | "regex";
+
+  path: string;
+};
+
+type TrieNode = {
+  children: Map<string, TrieNode>;
+  exact: boolean; // An exact route ends at this node.
+  prefix: boolean; // A prefix route ends at this node.
+};
+
+function newNode(): TrieNode {
+  return { children: new Map(), exact: false, prefix: false };
+}
+
+function escapeRegex(s: string): string {
+  return s.replace(/[$()*+.?[\]^{|}\\]/g, "\\$&");
+}
+
+/**
+ * Generates the regex matching the paths of the trie, factored by their
+ * common prefixes; thus, its matching cost depends on the URL path length,
+ * rather than on the count of routes.
+ * @param node
+ */
+function trieRegex(node: TrieNode): string {
+  // NOTE: Once a prefix route has matched, nothing else matters.
+  if (node.prefix) return "";
+
+  const branches: string[] = [];
+  for (const [char, child] of node.children) {
+    let chain = escapeRegex(char);
+    let next = child;
+    while (!next.exact && !next.prefix && next.children.size === 1) {
+      const [[c, n]] = next.children;
+      chain += escapeRegex(c);
+      next = n;
+    }
+    branches.push(chain + trieRegex(next));
+  }
+  if (node.exact) branches.push("$");
+
+  return branches.length === 1 ? branches[0]! : `(?:${branches.join("|")})`;
+}
+
+/**
+ * Compiles routes with the same config into a single regex: literal (exact
+ * and prefix) routes are merged into a trie-factored anchored regex; only
+ * "regex" routes are added as separate alternatives.
+ * @param routes
+ */
+export function routesRegex(routes: Route[]): string {
+  const root = newNode();
+  let literal = false;
+  const regexes: string[] = [];
+  for (const { match = "prefix", path } of routes) {
+    if (path.includes('"')) {
+      throw Error(`Route path must not contain double quotes: ${path}`);
+    }
+    if (match === "regex") regexes.push(`(?:${path})`);
+    else {
+      if (path.includes("\\")) {
+        throw Error(`Route path must not contain backslashes: ${path}`);
+      }
+      let node = root;
+      for (const char of path) {
+        let child = node.children.get(char);
+        if (!child) {
+          child = newNode();
+          node.children.set(char, child);
+        }
+        node = child;
+      }
+      if (match === "exact") node.exact = true;
+      else node.prefix = true;
+      literal = true;
+    }
+  }
+  if (literal) regexes.unshift(`^${trieRegex(root)}`);
+  return regexes.join("|");
+}
+
+/**
+ * Generates Lighttpd config fragment for the routes: a single URL condition
+ * per distinct route config (in the order of their first appearance), thus
+ * a single regex match per request for all routes with the same config.
+ * @param routes
+ */
+export function routesConfig(routes: Route[]): string {
+  const groups = new Map<string, Route[]>();
+  for (const route of routes) {
+    const group = groups.get(route.config);
+    if (group) group.push(route);
+    else groups.set(route.config, [route]);
+  }
+
+  const res: string[] = [];
+  for (const [config, group] of groups) {
+    res.push(`$HTTP["url"] =~ "${routesRegex(group)}" {
+      ${config}
+    }`);
+  }
+  return res.join("\n");
+}
@@ -0,0 +1,161 @@
+// Server statistics: request counters kept by the native access log buffer,
+// and connection stats reported by Lighttpd's mod_status.
+
+/**
+ * URL path prefix of the library's own endpoints (e.g. the status page);
+ * requests to them are not accounted in the request counters.
+ * NOTE: The native access log buffers use the same prefix.
+ */
+export const STATUS_URL_PREFIX = "/.rn-static-server/";
+
+/**
+ * Upper bounds (ms) of request handling time ranges of ServerStats.latency
+ * histogram; the last range is unbounded.
+ * NOTE: The native access log buffers use the same bounds.
+ */
+export const LATENCY_BOUNDS = [1, 5, 10, 50, 100, 500, 1000];
+
+/**
+ * Snapshot of server request counters.
+ */
+export type ServerStats = {
+  // The total count of bytes received in requests (with headers) since
+  // the server launch.
+  bytesIn: number;
+
+  // The total count of bytes sent in responses (with headers) since
+  // the server launch.
+  bytesOut: number;
+
+  // The counts of requests by their handling time, in LATENCY_BOUNDS ranges:
+  // latency[0] - up to 1 ms, latency[1] - over 1 ms, up to 5 ms, etc.
+  latency: number[];
+
+  // The total count of requests handled since the server launch.
+  requests: number;
+
+  // The counts of responses by status class: "1xx" to "5xx".
+  statuses: { [statusClass: string]: number };
+
+  // The time (ms since epoch) the snapshot was taken.
+  timestamp: number;
+
+  // Server uptime, in seconds.
+  uptime: number;
+};
+
+/**
+ * Snapshot of server connection stats.
+ */
+export type ConnectionStats = {
+  // The count of connections currently open.
+  activeConnections: number;
+
+  // The count of open connections by their current states, keyed by
+  // Lighttpd's state codes (as in its status page scoreboard).
+  connectionStates: { [state: string]: number };
+
+  // The count of connection slots currently not used.
+  idleConnections: number;
+
+  // The cap of concurrent connections (server.max-connections), if known;
+  // once activeConnections reach it, new clients wait to be accepted.
+  maxConnections?: number;
+
+  // The time (ms since epoch) the snapshot was taken.
+  timestamp: number;
+};
+
+/**
+ * Returns a hard-to-guess URL path for the status page, so that it is not
+ * accessible to other clients of a server bound to a non-local address.
+ * @param token A secret random token (see getRandomToken() of the native
+ *  module).
+ */
+export function statusUrl(token: string): string {
+  return `${STATUS_URL_PREFIX}status-${token}`;
+}
+
+/**
+ * Parses the request counters JSON, reported by the native access log buffer.
+ * @param json
+ * @param timestamp
+ * @returns
+ */
+export function parseCounters(json: string, timestamp: number): ServerStats {
+  const native = JSON.parse(json);
+  const statuses: { [statusClass: string]: number } = {};
+  native.statuses.forEach((count: number, i: number) => {
+    statuses[`${i + 1}xx`] = count;
+  });
+  return {
+    bytesIn: native.bytesIn,
+    bytesOut: native.bytesOut,
+    latency: native.latency,
+    requests: native.requests,
+    statuses,
+    timestamp,
+    uptime: native.uptime,
+  };
+}
+
+/**
+ * Parses the machine-readable status page (the "?auto" format)
+ * of Lighttpd's mod_status into a key-value map.
+ * @param text
+ * @returns
+ */
+function parseStatusFields(text: string): { [key: string]: string } {
+  const fields: { [key: string]: string } = {};
+  for (const line of text.split("\n")) {
+    const pos = line.indexOf(":");
+    if (pos > 0) fields[line.slice(0, pos)] = line.slice(pos + 1).trim();
+  }
+  return fields;
+}
+
+/**
+ * The scoreboard state of the connection serving the status page itself,
+ * at the time the page is generated ("handling a request").
+ */
+const STATUS_PROBE_STATE = "h";
+
+/**
+ * Parses the connection stats from the status page of mod_status. The status
+ * page request itself is not accounted: its connection is subtracted from
+ * the busy ones, and is counted as an idle slot.
+ * @param text
+ * @param timestamp
+ * @returns
+ */
+export function parseConnections(
+  text: string,
+  timestamp: number,
+): ConnectionStats {
+  const fields = parseStatusFields(text);
+
+  const connectionStates: { [state: string]: number } = {};
+  for (const state of fields.Scoreboard || "") {
+    // "_" marks a free connection slot.
+    if (state !== "_") {
+      connectionStates[state] = (connectionStates[state] || 0) + 1;
+    }
+  }
+
+  let activeConnections = Number(fields.BusyServers) || 0;
+  let idleConnections = Number(fields.IdleServers) || 0;
+  if (activeConnections > 0) {
+    --activeConnections;
+    ++idleConnections;
+    const probes = connectionStates[STATUS_PROBE_STATE];
+    if (probes === 1) delete connectionStates[STATUS_PROBE_STATE];
+    else if (probes) connectionStates[STATUS_PROBE_STATE] = probes - 1;
+  }
+
+  return {
+    activeConnections,
+    connectionStates,
+    idleConnections,
+    timestamp,
+  };
+}
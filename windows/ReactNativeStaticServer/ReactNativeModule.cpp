@@ -2,8 +2,10 @@
 #include "ReactNativeModule.h"
 #include <ppltasks.h>
 
-#include <condition_variable>
 #include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
 
 #include "Errors.h"
 #include "Server.h"
@@ -11,63 +13,176 @@
 using namespace std::chrono_literals;
 using namespace winrt::ReactNativeStaticServer;
 using namespace winrt::Windows::Networking::Connectivity;
+using namespace winrt::Windows::Security::Cryptography;
+using namespace winrt::Windows::System;
 
 ReactNativeModule* mod;
-React::ReactPromise<std::string>* pendingResult;
+
+// The size (bytes) of tokens generated by getRandomToken().
+const uint32_t RANDOM_TOKEN_SIZE = 16;
+
+// NOTE: The server lifecycle is a state machine, with all globals below
+// guarded by state_guard; its transitions are triggered by start() and stop()
+// calls, and by signals from the server thread. The mutex is only held for
+// the transitions themselves, and never while waiting for the server, thus
+// start() and stop() never block the calling thread; their promises are
+// queued, and settled by the server signals.
+enum class State { IDLE, STARTING, ACTIVE, STOPPING };
+
+struct StartRequest {
+  double id;
+  std::string configPath;
+  std::string errlogPath;
+  ThreadPriority threadPriority;
+  bool bigCores;
+  std::vector<React::ReactPromise<std::string>> promises;
+};
+
+typedef std::vector<React::ReactPromise<std::string>> Promises;
+
+std::mutex state_guard;
+State state = State::IDLE;
 Server *server;
+std::string launchDetails;
+Promises startPromises;
+Promises stopPromises;
 
-// There is no semaphore in C++ STL prior to C++20,
-// thus we have to make it ourselves.
-boolean sem = true;
-std::mutex sem_guard;
-std::condition_variable sem_cv;
+// Set when stop() is called while the server is starting; the server is
+// stopped as soon as it is launched.
+bool stopRequested = false;
 
-void lock_sem() {
-  std::unique_lock lk(sem_guard);
-  sem_cv.wait(lk, [] { return sem; });
-  sem = false;
-}
+// The start request received while the server is stopping (or is to be
+// stopped); it is launched once the current server terminates, i.e. start()
+// during stop becomes a restart.
+std::optional<StartRequest> nextStart;
 
-void unlock_sem() {
-  std::lock_guard lk(sem_guard);
-  if (sem) throw std::exception("Internal synchronization error");
-  sem = true;
-  sem_cv.notify_one();
+void OnSignal(std::string signal, std::string details);
+
+// Launches a new server; it must be called with state_guard locked.
+void launch(const StartRequest &request) {
+  server = new Server(request.id, request.configPath, request.errlogPath,
+    request.threadPriority, request.bigCores, OnSignal);
+  state = State::STARTING;
+  launchDetails.clear();
+  server->launch();
 }
 
 void OnSignal(std::string signal, std::string details) {
-    // BEWARE: .sendEvent() depends on the server object to get its ID,
-    // thus MUST BE called before the object is dropped below, if it is.
-    if (!pendingResult) mod->sendEvent(signal, details);
-
-    double id = server->id();
-    if (signal == CRASHED || signal == TERMINATED) {
-      delete server;
-      server = NULL;
+    Promises starts, stops;
+    double id;
+    {
+      std::lock_guard lk(state_guard);
+      id = server->id();
+      starts.swap(startPromises);
+      if (signal == LAUNCHED) {
+        state = State::ACTIVE;
+        launchDetails = details;
+        if (stopRequested) {
+          stopRequested = false;
+          state = State::STOPPING;
+          server->shutdown();
+        }
+      } else {
+        delete server;
+        server = NULL;
+        state = State::IDLE;
+        stopRequested = false;
+        stops.swap(stopPromises);
+        if (nextStart) {
+          StartRequest next = std::move(*nextStart);
+          nextStart.reset();
+          launch(next);
+          startPromises = std::move(next.promises);
+        }
+      }
     }
 
-    if (pendingResult) {
-      if (signal == CRASHED) {
-        RNException("Server #" + std::to_string(id) + " crashed").reject(*pendingResult);
-      }
-      else pendingResult->Resolve(details);
-      delete pendingResult;
-      pendingResult = NULL;
-      unlock_sem();
+    if (starts.empty() && stops.empty()) mod->sendEvent(id, signal, details);
+    else if (signal == CRASHED) {
+      RNException e("Server #" + std::to_string(id) + " crashed");
+      for (auto& p : starts) e.reject(p);
+      for (auto& p : stops) e.reject(p);
+    } else {
+      for (auto& p : starts) p.Resolve(details);
+      for (auto& p : stops) p.Resolve(details);
+    }
+}
+
+void ReactNativeModule::Initialize(ReactContext const& reactContext) noexcept {
+    // NOTE: Memory usage notifications are not available to some app types,
+    // in which case the server just does not react to memory pressure.
+    try {
+        _memoryUsageIncreased = MemoryManager::AppMemoryUsageIncreased(
+            winrt::auto_revoke,
+            [](auto&&, auto&&) {
+                auto level = MemoryManager::AppMemoryUsageLevel();
+                if (level != AppMemoryUsageLevel::High
+                    && level != AppMemoryUsageLevel::OverLimit) return;
+                std::lock_guard lk(state_guard);
+                if (server) server->trimMemory();
+            });
+    }
+    catch (...) {
+        // NOOP
     }
 }
 
 ReactNativeStaticServerSpec_Constants ReactNativeModule::GetConstants() noexcept {
     ReactNativeStaticServerSpec_Constants res;
     res.CRASHED = CRASHED;
+    res.DEVICE_CORES = std::thread::hardware_concurrency();
+
+    // NOTE: Lighttpd on Windows is not bound by a CRT file descriptors
+    // limit, thus it is reported as unknown.
+    res.DEVICE_FD_LIMIT = 0;
+
+    MEMORYSTATUSEX memory{sizeof(memory)};
+    res.DEVICE_RAM = GlobalMemoryStatusEx(&memory)
+        ? static_cast<double>(memory.ullTotalPhys) : 0;
     res.IS_MAC_CATALYST = false;
     res.LAUNCHED = LAUNCHED;
+    res.LOG = LOG;
     res.TERMINATED = TERMINATED;
     return res;
 }
 
+void ReactNativeModule::dumpTrace(
+    std::string dir,
+    React::ReactPromise<std::string>&& result
+) noexcept {
+    RNException("Tracing is not supported on Windows").reject(result);
+}
+
+void ReactNativeModule::exportAccessLog(
+    std::string path,
+    React::ReactPromise<double>&& result
+) noexcept {
+    RNException("Access log is not supported on Windows").reject(result);
+}
+
 void ReactNativeModule::getActiveServerId(React::ReactPromise<std::optional<double>>&& result) noexcept {
-  result.Resolve(server ? std::optional(server->id()) : std::nullopt);
+  std::optional<double> id;
+  {
+    std::lock_guard lk(state_guard);
+    if (server) id = server->id();
+  }
+  result.Resolve(id);
+}
+
+void ReactNativeModule::getRandomToken(React::ReactPromise<std::string>&& result) noexcept {
+    try {
+        auto bytes = CryptographicBuffer::GenerateRandom(RANDOM_TOKEN_SIZE);
+        result.Resolve(winrt::to_string(CryptographicBuffer::EncodeToHexString(bytes)));
+    }
+    catch (...) {
+        RNException("Failed to generate a random token").reject(result);
+    }
+}
+
+void ReactNativeModule::getStats(React::ReactPromise<std::string>&& result) noexcept {
+    // NOTE: The request counters are kept by the access log reader, which is
+    // not implemented on Windows; the JS layer rejects `stats` option there.
+    RNException("Request counters are not supported on Windows").reject(result);
 }
 
 void ReactNativeModule::getLocalIpAddress(React::ReactPromise<std::string>&& result) noexcept {
@@ -123,9 +238,9 @@ void ReactNativeModule::getOpenPort(
     RNException("Failed to get an open port").reject(result);
 }
 
-void ReactNativeModule::sendEvent(std::string signal, std::string details) {
+void ReactNativeModule::sendEvent(double id, std::string signal, std::string details) {
     JSValueObject obj = JSValueObject{
-            {"serverId", server->id()},
+            {"serverId", id},
             {"event", signal},
             {"details", details}
     };
@@ -136,62 +251,69 @@ void ReactNativeModule::start(
     double id,
     std::string configPath,
     std::string errlogPath,
+    double errlogBufferSize, // NOTE: Not supported on Windows, ignored.
+    double accessLogCapacity, // NOTE: Not supported on Windows, ignored.
+    double accessLogSampleRate, // NOTE: Not supported on Windows, ignored.
+    bool stats, // NOTE: Not supported on Windows, ignored.
+    std::string threadPriority,
+    bool bigCores,
     React::ReactPromise<std::string>&& result
 ) noexcept {
-    lock_sem();
-
-    if (server) {
-      RNException(
-        "Failed to launch server #" + std::to_string(id) +
-        ", another server instance (#" + server->id_str() + ") is active").reject(result);
-      unlock_sem();
-      return;
-    };
-
-    if (pendingResult) {
-      RNException("Internal error").reject(result);
-      unlock_sem();
-      return;
+    StartRequest request{id, configPath, errlogPath,
+      ParseThreadPriority(threadPriority), bigCores};
+    std::optional<std::string> error;
+    std::optional<std::string> details;
+    {
+      std::lock_guard lk(state_guard);
+      mod = this;
+      if (state == State::STOPPING || stopRequested) {
+        if (nextStart && nextStart->id != id) {
+          error = "Failed to launch server #" + std::to_string(id) +
+            ", another server instance (#" + std::to_string(nextStart->id) +
+            ") is pending";
+        } else {
+          if (!nextStart) nextStart = std::move(request);
+          nextStart->promises.push_back(result);
+        }
+      } else if (state == State::IDLE) {
+        launch(request);
+        startPromises.push_back(result);
+      } else if (server->id() != id) {
+        error = "Failed to launch server #" + std::to_string(id) +
+          ", another server instance (#" + server->id_str() + ") is active";
+      } else if (state == State::STARTING) startPromises.push_back(result);
+      else details = launchDetails;
     }
-
-    mod = this;
-    pendingResult = new React::ReactPromise<std::string>(result);
-    server = new Server(id, configPath, errlogPath, OnSignal);
-    server->launch();
+    if (error) RNException(std::move(*error)).reject(result);
+    else if (details) result.Resolve(*details);
 }
 
 void ReactNativeModule::stop(React::ReactPromise<std::string>&& result) noexcept {
-    try {
-        lock_sem();
-
-        // The synchronization in JS layer is supposed to ensure this native
-        // .stop() is never called before any previous pendingResult is settled
-        // and cleaned up.
-        if (pendingResult) {
-          unlock_sem();
-          RNException("Internal error").reject(result);
-          return;
-        }
-
-        // This means either the server has crashed at the same time we were
-        // about to ask it to gracefully shutdown, or there is some error in
-        // JS layer, which is not supposed to call this native .stop() unless
-        // an active server instance exists.
-        if (!server) {
-          RNException("No active server").reject(result);
-          unlock_sem();
-          return;
-        }
-
-        pendingResult = new React::ReactPromise<std::string>(result);
-        server->shutdown();
-
-        // The OnSignal() handler will dispose the server once TERMINATED,
-        // or CRASHED signal is received, and it will settle and clean up
-        // pendingPromise; anything else going wrong, the try/catch block
-        // will catch it and report to JS layer in RN way.
+    std::optional<StartRequest> cancelled;
+    bool stopped = false;
+    {
+      std::lock_guard lk(state_guard);
+      cancelled.swap(nextStart);
+      switch (state) {
+        case State::IDLE:
+          stopped = true;
+          break;
+        case State::STARTING:
+          stopRequested = true;
+          break;
+        case State::ACTIVE:
+          state = State::STOPPING;
+          server->shutdown();
+          break;
+        default:
+          break;
+      }
+      if (!stopped) stopPromises.push_back(result);
     }
-    catch (...) {
-        RNException("Failed to gracefully shutdown the server #" + server->id_str()).reject(result);
+    if (cancelled) {
+      RNException e("Launch of server #" + std::to_string(cancelled->id) +
+        " was cancelled by a stop request");
+      for (auto& p : cancelled->promises) e.reject(p);
     }
+    if (stopped) result.Resolve("");
 }
@@ -15,6 +15,9 @@ struct ReactNativeModule
 {
     using ModuleSpec = ReactNativeStaticServerSpec;
 
+    REACT_INIT(Initialize)
+    void Initialize(ReactContext const& reactContext) noexcept;
+
     REACT_GET_CONSTANTS(GetConstants)
     ReactNativeStaticServerSpec_Constants GetConstants() noexcept;
 
@@ -31,11 +34,23 @@ struct ReactNativeModule
     REACT_EVENT(EmitEvent, L"RNStaticServer");
     std::function<void(JSValue)> EmitEvent;
 
-    void sendEvent(std::string signal, std::string details);
+    void sendEvent(double id, std::string signal, std::string details);
+
+    REACT_METHOD(dumpTrace)
+    void dumpTrace(std::string dir, React::ReactPromise<std::string>&& result) noexcept;
+
+    REACT_METHOD(exportAccessLog)
+    void exportAccessLog(std::string path, React::ReactPromise<double>&& result) noexcept;
 
     REACT_METHOD(getActiveServerId)
     void getActiveServerId(React::ReactPromise<std::optional<double>>&& result) noexcept;
 
+    REACT_METHOD(getRandomToken)
+    void getRandomToken(React::ReactPromise<std::string>&& result) noexcept;
+
+    REACT_METHOD(getStats)
+    void getStats(React::ReactPromise<std::string>&& result) noexcept;
+
     REACT_METHOD(getLocalIpAddress)
     void getLocalIpAddress(React::ReactPromise<std::string>&& result) noexcept;
 
@@ -46,10 +61,20 @@ struct ReactNativeModule
     void start(double id,
         std::string configPath,
         std::string errlogPath,
+        double errlogBufferSize,
+        double accessLogCapacity,
+        double accessLogSampleRate,
+        bool stats,
+        std::string threadPriority,
+        bool bigCores,
         React::ReactPromise<std::string>&& result) noexcept;
 
     REACT_METHOD(stop)
     void stop(React::ReactPromise<std::string>&& result) noexcept;
+
+private:
+    winrt::Windows::System::MemoryManager::AppMemoryUsageIncreased_revoker
+        _memoryUsageIncreased;
 };
 
 } // namespace winrt::ReactNativeStaticServer
@@ -1,6 +1,8 @@
 #include "pch.h"
 #include "Server.h"
-#include <ppltasks.h>
+
+#include <thread>
+#include <vector>
 
 using namespace winrt::ReactNativeStaticServer;
 using namespace winrt::Windows::ApplicationModel;
@@ -47,27 +49,86 @@ void LoadLighttpdDll() {
     }
 }
 
+ThreadPriority winrt::ReactNativeStaticServer::ParseThreadPriority(
+    const std::string& name
+) {
+    if (name == "interactive") return ThreadPriority::INTERACTIVE;
+    if (name == "utility") return ThreadPriority::UTILITY;
+    return ThreadPriority::DEFAULT;
+}
+
+// Restricts the current thread to the CPU sets of the highest efficiency class,
+// i.e. to the performance cores of hybrid CPUs; on CPUs with uniform cores
+// that is all cores, thus effectively a no-op.
+void PinToBigCores() {
+    ULONG size = 0;
+    HANDLE process = GetCurrentProcess();
+    GetSystemCpuSetInformation(nullptr, 0, &size, process, 0);
+    std::vector<uint8_t> buffer(size);
+    if (!size || !GetSystemCpuSetInformation(
+        (PSYSTEM_CPU_SET_INFORMATION)buffer.data(), size, &size, process, 0)) {
+        return;
+    }
+
+    BYTE bigClass = 0;
+    std::vector<ULONG> ids;
+    for (ULONG pos = 0; pos < size;) {
+        auto info = (PSYSTEM_CPU_SET_INFORMATION)(buffer.data() + pos);
+        pos += info->Size;
+        if (info->Type != CpuSetInformation) continue;
+        if (info->CpuSet.EfficiencyClass > bigClass) {
+            bigClass = info->CpuSet.EfficiencyClass;
+            ids.clear();
+        }
+        if (info->CpuSet.EfficiencyClass == bigClass) {
+            ids.push_back(info->CpuSet.Id);
+        }
+    }
+    if (!ids.empty()) {
+        SetThreadSelectedCpuSets(GetCurrentThread(), ids.data(), (ULONG)ids.size());
+    }
+}
+
 void Server::OnLaunchedCallback() {
-    Server::activeServer->_signalConsumer(LAUNCHED, "");
+    Server::activeServer->_signalConsumer(LAUNCHED, Server::activeServer->launchTimings());
 }
 
 Server::Server(
     double id,
     std::string configPath,
     std::string errlogPath,
+    ThreadPriority threadPriority,
+    bool bigCores,
     SignalConsumer signalConsumer
 ):
     _id(id),
     _configPath(configPath),
     _errlogPath(errlogPath),
-    _signalConsumer(signalConsumer)
+    _threadPriority(threadPriority),
+    _bigCores(bigCores),
+    _signalConsumer(signalConsumer),
+    _createdAt(std::chrono::steady_clock::now())
 {
      if (!LighttpdLaunch) LoadLighttpdDll();
 }
 
+// NOTE: Lighttpd runs its event loop until the shutdown, thus it gets its own
+// dedicated thread, rather than a task of the shared thread pool, where it
+// could be starved by (and starve) other pool work.
 void Server::launch() {
-    concurrency::task task = concurrency::create_task(
+    std::thread(
         [this] {
+            this->_threadStartedAt = std::chrono::steady_clock::now();
+            switch (this->_threadPriority) {
+                case ThreadPriority::INTERACTIVE:
+                    SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_ABOVE_NORMAL);
+                    break;
+                case ThreadPriority::UTILITY:
+                    SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_BELOW_NORMAL);
+                    break;
+                default:;
+            }
+            if (this->_bigCores) PinToBigCores();
             if (Server::activeServer) {
                 // Bail out with error if another server instance is running.
                 this->_signalConsumer(CRASHED, "Another Server instance is active");
@@ -78,6 +139,7 @@ void Server::launch() {
             modulesPath += "\\ReactNativeStaticServer";
             try {
                 Server::activeServer = this;
+                this->_launchCalledAt = std::chrono::steady_clock::now();
                 int res = LighttpdLaunch(
                     this->_configPath.c_str(),
                     modulesPath.c_str(),
@@ -95,9 +157,26 @@ void Server::launch() {
                 this->_signalConsumer(CRASHED, "");
             }
         }
-    );
+    ).detach();
+}
+
+std::string Server::launchTimings() {
+    auto now = std::chrono::steady_clock::now();
+    auto ms = [this](std::chrono::steady_clock::time_point t) {
+        return std::to_string(
+            std::chrono::duration<double, std::milli>(t - this->_createdAt).count());
+    };
+    return "{\"threadStart\":" + ms(this->_threadStartedAt)
+        + ",\"launchCall\":" + ms(this->_launchCalledAt)
+        + ",\"launched\":" + ms(now) + "}";
 }
 
 void Server::shutdown() {
     LighttpdShutdown();
 }
+
+// NOTE: Lighttpd DLLs are built against UCRT, which allocates from
+// the process heap.
+void Server::trimMemory() {
+    HeapCompact(GetProcessHeap(), 0);
+}
@@ -1,21 +1,33 @@
 #pragma once
 
+#include <chrono>
 #include <string>
 
 namespace winrt::ReactNativeStaticServer {
 
 	static const std::string CRASHED = "CRASHED";
 	static const std::string LAUNCHED = "LAUNCHED";
+	static const std::string LOG = "LOG";
 	static const std::string TERMINATED = "TERMINATED";
 
 	typedef void (*SignalConsumer)(std::string signal, std::string details);
 
+	// Priority of the server thread, see the thread.priority option
+	// of StaticServer in README.md.
+	enum class ThreadPriority { DEFAULT, INTERACTIVE, UTILITY };
+
+	// Parses the priority name ("default", "interactive", or "utility")
+	// received from the JS layer; unknown names fall back to DEFAULT.
+	ThreadPriority ParseThreadPriority(const std::string& name);
+
 	class Server {
 	public:
 		Server(
       double id,
 			std::string configPath,
 			std::string errlogPath,
+			ThreadPriority threadPriority,
+			bool bigCores,
 			SignalConsumer signalConsumer);
 
     inline double id() { return _id; }
@@ -23,12 +35,31 @@ namespace winrt::ReactNativeStaticServer {
 
 		void launch();
 		void shutdown();
+
+		// Responds to memory pressure: returns to the system the free memory
+		// kept by the process heap (e.g. the buffers released by Lighttpd).
+		void trimMemory();
+
+		// Returns JSON with durations (ms) from the server object creation
+		// (i.e. the native start() call) till the server thread start, till
+		// LighttpdLaunch() call, and till now (the LAUNCHED callback).
+		std::string launchTimings();
 	private:
     double _id;
 		std::string _configPath;
 		std::string _errlogPath;
+		ThreadPriority _threadPriority;
+
+		// If set, the server thread is restricted to the performance cores
+		// (the highest efficiency class) of hybrid CPUs.
+		bool _bigCores;
+
 		SignalConsumer _signalConsumer;
 
+		std::chrono::steady_clock::time_point _createdAt;
+		std::chrono::steady_clock::time_point _launchCalledAt;
+		std::chrono::steady_clock::time_point _threadStartedAt;
+
 		static Server* activeServer;
 
 		static void OnLaunchedCallback();
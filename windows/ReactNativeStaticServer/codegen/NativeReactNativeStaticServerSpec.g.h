@@ -16,8 +16,12 @@ namespace winrt::ReactNativeStaticServer {
 
 struct ReactNativeStaticServerSpec_Constants {
     std::string CRASHED;
+    double DEVICE_CORES;
+    double DEVICE_FD_LIMIT;
+    double DEVICE_RAM;
     bool IS_MAC_CATALYST;
     std::string LAUNCHED;
+    std::string LOG;
     std::string TERMINATED;
 };
 
@@ -25,8 +29,12 @@ struct ReactNativeStaticServerSpec_Constants {
 inline winrt::Microsoft::ReactNative::FieldMap GetStructInfo(ReactNativeStaticServerSpec_Constants*) noexcept {
     winrt::Microsoft::ReactNative::FieldMap fieldMap {
         {L"CRASHED", &ReactNativeStaticServerSpec_Constants::CRASHED},
+        {L"DEVICE_CORES", &ReactNativeStaticServerSpec_Constants::DEVICE_CORES},
+        {L"DEVICE_FD_LIMIT", &ReactNativeStaticServerSpec_Constants::DEVICE_FD_LIMIT},
+        {L"DEVICE_RAM", &ReactNativeStaticServerSpec_Constants::DEVICE_RAM},
         {L"IS_MAC_CATALYST", &ReactNativeStaticServerSpec_Constants::IS_MAC_CATALYST},
         {L"LAUNCHED", &ReactNativeStaticServerSpec_Constants::LAUNCHED},
+        {L"LOG", &ReactNativeStaticServerSpec_Constants::LOG},
         {L"TERMINATED", &ReactNativeStaticServerSpec_Constants::TERMINATED},
     };
     return fieldMap;
@@ -38,12 +46,16 @@ struct ReactNativeStaticServerSpec : winrt::Microsoft::ReactNative::TurboModuleS
   };
   static constexpr auto methods = std::tuple{
       Method<void(std::string) noexcept>{0, L"addListener"},
-      Method<void(Promise<std::optional<double>>) noexcept>{1, L"getActiveServerId"},
-      Method<void(double) noexcept>{2, L"removeListeners"},
-      Method<void(double, std::string, std::string, Promise<std::string>) noexcept>{3, L"start"},
-      Method<void(Promise<std::string>) noexcept>{4, L"getLocalIpAddress"},
-      Method<void(std::string, Promise<double>) noexcept>{5, L"getOpenPort"},
-      Method<void(Promise<std::string>) noexcept>{6, L"stop"},
+      Method<void(std::string, Promise<std::string>) noexcept>{1, L"dumpTrace"},
+      Method<void(std::string, Promise<double>) noexcept>{2, L"exportAccessLog"},
+      Method<void(Promise<std::optional<double>>) noexcept>{3, L"getActiveServerId"},
+      Method<void(Promise<std::string>) noexcept>{4, L"getRandomToken"},
+      Method<void(Promise<std::string>) noexcept>{5, L"getStats"},
+      Method<void(double) noexcept>{6, L"removeListeners"},
+      Method<void(double, std::string, std::string, double, double, double, bool, std::string, bool, Promise<std::string>) noexcept>{7, L"start"},
+      Method<void(Promise<std::string>) noexcept>{8, L"getLocalIpAddress"},
+      Method<void(std::string, Promise<double>) noexcept>{9, L"getOpenPort"},
+      Method<void(Promise<std::string>) noexcept>{10, L"stop"},
   };
 
   template <class TModule>
@@ -64,31 +76,51 @@ struct ReactNativeStaticServerSpec : winrt::Microsoft::ReactNative::TurboModuleS
           "    REACT_METHOD(addListener) static void addListener(std::string eventName) noexcept { /* implementation */ }\n");
     REACT_SHOW_METHOD_SPEC_ERRORS(
           1,
+          "dumpTrace",
+          "    REACT_METHOD(dumpTrace) void dumpTrace(std::string dir, ::React::ReactPromise<std::string> &&result) noexcept { /* implementation */ }\n"
+          "    REACT_METHOD(dumpTrace) static void dumpTrace(std::string dir, ::React::ReactPromise<std::string> &&result) noexcept { /* implementation */ }\n");
+    REACT_SHOW_METHOD_SPEC_ERRORS(
+          2,
+          "exportAccessLog",
+          "    REACT_METHOD(exportAccessLog) void exportAccessLog(std::string path, ::React::ReactPromise<double> &&result) noexcept { /* implementation */ }\n"
+          "    REACT_METHOD(exportAccessLog) static void exportAccessLog(std::string path, ::React::ReactPromise<double> &&result) noexcept { /* implementation */ }\n");
+    REACT_SHOW_METHOD_SPEC_ERRORS(
+          3,
           "getActiveServerId",
           "    REACT_METHOD(getActiveServerId) void getActiveServerId(::React::ReactPromise<std::optional<double>> &&result) noexcept { /* implementation */ }\n"
           "    REACT_METHOD(getActiveServerId) static void getActiveServerId(::React::ReactPromise<std::optional<double>> &&result) noexcept { /* implementation */ }\n");
     REACT_SHOW_METHOD_SPEC_ERRORS(
-          2,
+          4,
+          "getRandomToken",
+          "    REACT_METHOD(getRandomToken) void getRandomToken(::React::ReactPromise<std::string> &&result) noexcept { /* implementation */ }\n"
+          "    REACT_METHOD(getRandomToken) static void getRandomToken(::React::ReactPromise<std::string> &&result) noexcept { /* implementation */ }\n");
+    REACT_SHOW_METHOD_SPEC_ERRORS(
+          5,
+          "getStats",
+          "    REACT_METHOD(getStats) void getStats(::React::ReactPromise<std::string> &&result) noexcept { /* implementation */ }\n"
+          "    REACT_METHOD(getStats) static void getStats(::React::ReactPromise<std::string> &&result) noexcept { /* implementation */ }\n");
+    REACT_SHOW_METHOD_SPEC_ERRORS(
+          6,
           "removeListeners",
           "    REACT_METHOD(removeListeners) void removeListeners(double count) noexcept { /* implementation */ }\n"
           "    REACT_METHOD(removeListeners) static void removeListeners(double count) noexcept { /* implementation */ }\n");
     REACT_SHOW_METHOD_SPEC_ERRORS(
-          3,
+          7,
           "start",
-          "    REACT_METHOD(start) void start(double id, std::string configPath, std::string errlogPath, ::React::ReactPromise<std::string> &&result) noexcept { /* implementation */ }\n"
-          "    REACT_METHOD(start) static void start(double id, std::string configPath, std::string errlogPath, ::React::ReactPromise<std::string> &&result) noexcept { /* implementation */ }\n");
+          "    REACT_METHOD(start) void start(double id, std::string configPath, std::string errlogPath, double errlogBufferSize, double accessLogCapacity, double accessLogSampleRate, bool stats, std::string threadPriority, bool bigCores, ::React::ReactPromise<std::string> &&result) noexcept { /* implementation */ }\n"
+          "    REACT_METHOD(start) static void start(double id, std::string configPath, std::string errlogPath, double errlogBufferSize, double accessLogCapacity, double accessLogSampleRate, bool stats, std::string threadPriority, bool bigCores, ::React::ReactPromise<std::string> &&result) noexcept { /* implementation */ }\n");
     REACT_SHOW_METHOD_SPEC_ERRORS(
-          4,
+          8,
           "getLocalIpAddress",
           "    REACT_METHOD(getLocalIpAddress) void getLocalIpAddress(::React::ReactPromise<std::string> &&result) noexcept { /* implementation */ }\n"
           "    REACT_METHOD(getLocalIpAddress) static void getLocalIpAddress(::React::ReactPromise<std::string> &&result) noexcept { /* implementation */ }\n");
     REACT_SHOW_METHOD_SPEC_ERRORS(
-          5,
+          9,
           "getOpenPort",
           "    REACT_METHOD(getOpenPort) void getOpenPort(std::string address, ::React::ReactPromise<double> &&result) noexcept { /* implementation */ }\n"
           "    REACT_METHOD(getOpenPort) static void getOpenPort(std::string address, ::React::ReactPromise<double> &&result) noexcept { /* implementation */ }\n");
     REACT_SHOW_METHOD_SPEC_ERRORS(
-          6,
+          10,
           "stop",
           "    REACT_METHOD(stop) void stop(::React::ReactPromise<std::string> &&result) noexcept { /* implementation */ }\n"
           "    REACT_METHOD(stop) static void stop(::React::ReactPromise<std::string> &&result) noexcept { /* implementation */ }\n");
@@ -22,6 +22,8 @@
 #include <winrt/Windows.ApplicationModel.h>
 #include <winrt/Windows.Networking.Connectivity.h>
 #include <winrt/Windows.Networking.Sockets.h>
+#include <winrt/Windows.Security.Cryptography.h>
 #include <winrt/Windows.Storage.h>
+#include <winrt/Windows.System.h>
 
 using namespace winrt::Windows::Foundation;
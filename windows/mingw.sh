@@ -11,7 +11,9 @@ set -e
 # - Check-out the correct code version in the /lighttpd1.4 folder (the master
 #   branch of Lighttpd repo does not support MinGW build yet, you need some
 #   commit from the win32-exp branch).
-# - Then run this script from within the same MSYS2 UCRT64 console.
+# - Then run this script from within the same MSYS2 UCRT64 console. Its
+#   arguments, if any, are passed to CMake, e.g. build optimization options
+#   (see "Build Optimization" in README.md).
 
 SCRIPT_FOLDER=$(dirname $(realpath $0))
 ROOT_FOLDER=$(dirname $SCRIPT_FOLDER)
@@ -20,8 +22,9 @@ OUTPUT_FOLDER="$SCRIPT_FOLDER/ReactNativeStaticServer/lighttpd"
 MSYS2_PATH="/ucrt64"
 
 cmake $ROOT_FOLDER -B $BUILD_FOLDER -G Ninja \
-  -DBUILD_LIBRARY=ON -DCMAKE_BUILD_TYPE=Release
-cmake --build $BUILD_FOLDER --target mod_dirlisting mod_h2 mod_webdav lighttpd
+  -DBUILD_LIBRARY=ON -DCMAKE_BUILD_TYPE=Release "$@"
+cmake --build $BUILD_FOLDER --target mod_dirlisting mod_h2 mod_status mod_webdav \
+  lighttpd
 
 mkdir -p $OUTPUT_FOLDER
 cd $BUILD_FOLDER/lighttpd1.4/build